@@ -19,17 +19,20 @@
 //     Then, go back into the Tools menu and find the Processor option and select “ATmega328”.
 //
 //   [Press] the SW1 button to cycle through available effects
+//   [Double-click] the SW1 button to go back to the previous effect
 //   Effects will also automatically cycle at startup
 //   [Press and hold] the SW1 button (one second) to switch between auto and manual mode
 //     * Auto Mode (one blue blink): Effects automatically cycle over time
 //     * Manual Mode (two red blinks): Effects must be selected manually with SW1 button
 //
 //   [Press] the SW2 button to cycle through available brightness levels
-//   [Press and hold] the SW2 button (one second) to reset brightness to startup value
+//   [Press and hold] the SW2 button (one second) to reset brightness to startup value (one white flash)
+//   [Double-click] the SW2 button to play the scripted show, when built with SHOW (see show.h)
 //
 //   [Press] SW1 and SW2 together to toggle between audio and non-audio effect sets
 //   You can edit the mix of effects (for example, both audio and standard patterns in the same set)
 //   Simply edit effectListAudio[] and effectListNoAudio[] below
+//   or layer one effect over another with composite() (see layers.h)
 //   When audio/non-audio mode has been toggled, you will see three green blinks.
 //
 //   Brightness, selected effect, and auto-cycle are saved in EEPROM after a delay
@@ -46,25 +49,93 @@
 #define MAXBRIGHTNESS 72
 #define STARTBRIGHTNESS 2
 
-// Cycle time (milliseconds between pattern changes)
-#define cycleTime 15000
-
-// Hue time (milliseconds between hue increments)
-#define hueTime 30
+// Cycle time (milliseconds between pattern changes) and hue time
+// (milliseconds between hue increments) are in params.h with the audio tuning
 
 // Time after changing settings before settings are saved to EEPROM
 #define EEPROMDELAY 2000
 
+// Sleep between frames, and dim after a while of silence in the audio sets (see power.h)
+#define POWERSAVE
+
+// RAM for looking up palette colours from a table instead of blending them each
+// time (see utils.h): 96 bytes for 32 colours, 192 for 64, none if not defined
+//#define PALETTECACHE 96
+
+// Field profiling: per-stage loop timing histograms sent on Serial (see timing.h)
+//#define PROFILING
+
+// Change the parameters in params.h over Serial without reflashing
+//#define TUNING
+
+// Report current and lowest free RAM on Serial (see memory.h)
+//#define RAMMONITOR
+
+// Stream every frame to a host visualizer on Serial (see stream.h)
+//#define STREAMING
+//#define STREAMDELTA // only send the LEDs that changed, costs 204 bytes of RAM
+
+// Let a computer drive the LEDs over Serial, add adalight to an effect list (see adalight.h)
+//#define ADALIGHT
+
+// Play the cue list in showdata.h, made by tools/show.py, on a double-click of SW2 (see show.h)
+//#define SHOW
+
+// Bytecode effects sent over Serial and kept in EEPROM, add vmEffect0 to 2 to an effect list (see vm.h)
+//#define VM
+
+// plasmaVU, a VU meter composited over plasma (layers.h, 129 bytes of RAM)
+//#define LAYEREFFECTS
+
+// fireflies and beatSparks, which share a pool of particles (particles.h, 256 bytes of RAM)
+//#define PARTICLEEFFECTS
+
+// waterfall, which keeps a second of the spectrum (history.h, 278 bytes of RAM)
+//#define HISTORYEFFECTS
+
+#ifdef BENCHMARK
+// the cycle counts cover these too
+#define LAYEREFFECTS
+#define PARTICLEEFFECTS
+#define HISTORYEFFECTS
+#endif
+
+// Deterministic mode for comparing builds: fixed random seed, a loop counter
+// instead of millis(), synthetic audio, and a 32-bit hash of each frame on Serial
+//#define DETERMINISTIC
+#define DETERMINISTIC_SEED 1337
+#define DETERMINISTIC_LOOPTIME 2 // milliseconds counted for each pass of loop()
+
 // Include FastLED library and other useful files
 #include <FastLED.h>
 #include <EEPROM.h>
 #include "messages.h"
 #include "font.h"
 #include "XYmap.h"
+#include "timing.h"
 #include "utils.h"
+#include "clock.h"
+#include "notify.h"
+#include "settings.h"
+#include "params.h"
 #include "audio.h"
+#include "memory.h"
+#include "animation.h"
+#include "baked.h"
+#include "pathdata.h"
+#include "blur.h"
+#include "paths.h"
 #include "effects.h"
+#include "layers.h"
+#include "particles.h"
+#include "history.h"
+#include "vm.h"
+#include "show.h"
 #include "buttons.h"
+#include "stream.h"
+#include "adalight.h"
+#include "serial.h"
+#include "power.h"
 
 // list of functions that will be displayed
 functionList effectListAudio[] = {
@@ -72,6 +143,23 @@ functionList effectListAudio[] = {
                                   //rings,
                                   audioShadesOutline,
                                   audioStripes,
+#ifdef LAYEREFFECTS
+                                  plasmaVU,
+#endif
+#ifdef PARTICLEEFFECTS
+                                  beatSparks,
+#endif
+#ifdef HISTORYEFFECTS
+                                  waterfall,
+#endif
+#ifdef BENCHMARK
+                                  // effects left out above, so the cycle counts cover them too, and
+                                  // the float check the FLOATFREE ones of bench/Makefile
+                                  noiseFlyer,
+                                  drawVU,
+                                  audioPlasma,
+                                  drawAnalyzer,
+#endif
                                   //audioCirc,
                                   //drawVU,
                                   //RGBpulse,
@@ -81,6 +169,7 @@ functionList effectListAudio[] = {
 
 functionList effectListNoAudio[] = {
                                     shadesOutline,
+                                    //comets,
                                     threeSine,
                                     //drawVU,
                                     //threeDee,
@@ -89,6 +178,9 @@ functionList effectListNoAudio[] = {
                                     plasma,
                                     //RGBpulse,
                                     confetti,
+#ifdef PARTICLEEFFECTS
+                                    fireflies,
+#endif
                                     //audioCirc,
                                     rider,
                                     //scrollTextOne,
@@ -99,7 +191,14 @@ functionList effectListNoAudio[] = {
                                     //audioPlasma,
                                     colorFill,
                                     //audioStripes,
-                                    sideRain
+                                    sideRain,
+#ifdef BENCHMARK
+                                    // left out above, for the cycle counts
+                                    comets,
+#endif
+                                    //ramMeter
+                                    //vmEffect0
+                                    //adalight
                                    };
 
 
@@ -107,19 +206,19 @@ byte numEffects;
 const byte numEffectsAudio = (sizeof(effectListAudio) / sizeof(effectListAudio[0]));
 const byte numEffectsNoAudio = (sizeof(effectListNoAudio) / sizeof(effectListNoAudio[0]));
 
+#ifdef DETERMINISTIC
+unsigned long loopCount = 0; // replaces millis() as the time source
+#endif
+
 
 // Runs one time at the start of the program (power up or reset)
 void setup() {
 
-  // check to see if EEPROM has been used yet
-  // if so, load the stored settings
-  byte eepromWasWritten = EEPROM.read(0);
-  if (eepromWasWritten == 99) {
-    currentEffect = EEPROM.read(1);
-    autoCycle = EEPROM.read(2);
-    currentBrightness = EEPROM.read(3);
-    audioEnabled = EEPROM.read(4);
-  }
+  // load the stored settings, if there are any
+  loadSettings();
+#ifdef TUNING
+  paramLoad();
+#endif
   
   switch (audioEnabled) {
     case true:
@@ -138,9 +237,10 @@ void setup() {
   // set global brightness value
   FastLED.setBrightness( scale8(nextBrightness(false), MAXBRIGHTNESS) );
   //FastLED.setDither(0);
-  // configure input buttons
-  pinMode(MODEBUTTON, INPUT_PULLUP);
-  pinMode(BRIGHTNESSBUTTON, INPUT_PULLUP);
+  cachePalette(); // for the starting palette
+  // start the frame clock and configure input buttons
+  setupClock();
+  setupButtons();
   pinMode(STROBEPIN, OUTPUT);
   pinMode(RESETPIN, OUTPUT);
 
@@ -149,8 +249,19 @@ void setup() {
   digitalWrite(RESETPIN, LOW);
   digitalWrite(STROBEPIN, HIGH);
 
+#ifdef DETERMINISTIC
+  random16_set_seed(DETERMINISTIC_SEED);
+#else
   random16_add_entropy(analogRead(ANALOGPIN));
-  //Serial.begin(115200);
+#endif
+
+#if defined(SERIALCOMMANDS) || defined(DETERMINISTIC)
+  Serial.begin(SERIALBAUD);
+#endif
+
+#ifdef BENCHMARK
+  benchSetup();
+#endif
 }
 
 
@@ -158,21 +269,45 @@ void setup() {
 // Runs over and over until power off or reset
 void loop()
 {
-  currentMillis = millis(); // save the current timer value
+#ifdef DETERMINISTIC
+  currentMillis = loopCount++ * DETERMINISTIC_LOOPTIME;
+#else
+  currentMillis = clockMillis(); // save the current timer value
+#endif
+#ifdef DRIFTTEST
+  driftSample();
+#endif
+  boolean effectRan = false;
+
+  STAGE_BEGIN(STAGE_UPDATEBUTTONS);
   updateButtons();          // read, debounce, and process the buttons
+  STAGE_END(STAGE_UPDATEBUTTONS);
+
+  STAGE_BEGIN(STAGE_DOBUTTONS);
   doButtons();              // perform actions based on button state
+  STAGE_END(STAGE_DOBUTTONS);
+
+  STAGE_BEGIN(STAGE_EEPROM);
   checkEEPROM();            // update the EEPROM if necessary
+  STAGE_END(STAGE_EEPROM);
+
+  doSerial();               // answer commands from a connected host
+  showUpdate();             // play the cues of a scripted show that are due
 
   // analyze the audio input
   if (audioActive) {
     if (currentMillis - audioMillis > AUDIODELAY) {
       audioMillis = currentMillis;
+      STAGE_BEGIN(STAGE_ANALOGS);
       doAnalogs();
+      STAGE_END(STAGE_ANALOGS);
+      if (historyRecorder) historyRecorder();
+      checkSilence();
     }
   }
 
   // switch to a new effect every cycleTime milliseconds
-  if (currentMillis - cycleMillis > cycleTime && autoCycle == true) {
+  if (currentMillis - cycleMillis > cycleTime && autoCycle == true && !showPlaying()) {
     cycleMillis = currentMillis;
     if (++currentEffect >= numEffects) currentEffect = 0; // loop to start of effect list
     effectInit = false; // trigger effect initialization when new effect is selected
@@ -188,6 +323,9 @@ void loop()
   // run the currently selected effect every effectDelay milliseconds
   if (currentMillis - effectMillis > effectDelay) {
     effectMillis = currentMillis;
+    effectRan = true;
+    if (effectInit == false) blurAmount = bloomAmount = 0; // a new effect sets its own
+    STAGE_BEGIN(STAGE_EFFECT);
     switch (audioEnabled) {
       case true:
         effectListAudio[currentEffect]();
@@ -196,14 +334,43 @@ void loop()
         effectListNoAudio[currentEffect]();
         break;
     }
+    STAGE_END(STAGE_EFFECT);
+    if (blurAmount || bloomAmount) {
+      STAGE_BEGIN(STAGE_POST);
+      postProcess();
+      STAGE_END(STAGE_POST);
+    }
     //random16_add_entropy(1); // make the random values a bit more random-ish
+#ifdef BENCHMARK
+    benchFrame();
+#endif
   }
 
   // run a fade effect
   if (fadeActive > 0) {
+    STAGE_BEGIN(STAGE_FADE);
     fadeAll(fadeActive);
+    STAGE_END(STAGE_FADE);
   }
 
-  FastLED.show(); // send the contents of the led memory to the LEDs
+  // adalight shows frames as they come in, and a host sending commands needs interrupts on
+  // a notification is drawn over the frame just for the show, the effect keeps its own
+  // and with POWERSAVE an unchanged frame isn't sent again
+  if (!adalightRunning() && !serialHoldShow() && powerShow(effectRan)) {
+    STAGE_BEGIN(STAGE_SHOW);
+    boolean notified = notifyDraw();
+    FastLED.show(); // send the contents of the led memory to the LEDs
+    streamShow();   // queue the frame as shown for a connected visualizer
+    if (notified) notifyRestore();
+    STAGE_END(STAGE_SHOW);
+  }
+
+  streamPump();   // carry on sending a queued frame
+
+#ifdef DETERMINISTIC
+  if (effectRan) Serial.println(frameHash(), HEX);
+#endif
+
+  powerSleep();   // until the next thing is due
 
 }
@@ -0,0 +1,136 @@
+// Adalight receive mode
+//
+// Lets a computer drive the shades over Serial with the Adalight protocol
+// used by Prismatik, Hyperion and friends. Each frame is
+//   'A' 'd' 'a', LED count - 1 (high byte, low byte), high ^ low ^ 0x55,
+// followed by RGB for each LED in leds[] order. Extra LEDs are ignored.
+//
+// Received bytes go from the Serial receive interrupt's buffer straight into
+// leds[], and a frame is shown as soon as its last byte is in. Add adalight
+// to an effect list: when a header arrives the shades switch to it from any
+// effect, and after ADALIGHTTIMEOUT without a frame they go on to the next
+// effect in the list.
+//
+// FastLED.show() blocks interrupts for about 2 ms and the UART only holds
+// two bytes meanwhile. Other effects show a frame on every pass of loop(),
+// so most of the first frame is lost, but loop() then holds off showing (see
+// SERIALQUIET in serial.h) and the next header gets through. While adalight
+// runs, the host has to leave a gap of about 2 ms after each frame, or the
+// next header is lost (and with it that frame).
+
+#ifdef ADALIGHT
+
+#define ADALIGHTTIMEOUT 5000
+#define ADALIGHTSTALL 100 // give up on a frame when the host stops halfway
+
+unsigned long adalightMillis = 0; // when the last frame was shown
+unsigned long adaByteMillis = 0;  // when the last byte of a frame came in
+
+byte adaState = 0; // 0-2 "Ada", 3-5 count and checksum, 6 LED data
+byte adaCountHigh;
+byte adaCountLow;
+uint16_t adaRemaining; // LED data bytes still to come in this frame
+uint16_t adaIndex;     // next byte of leds[] to fill
+
+extern functionList effectListAudio[];
+extern functionList effectListNoAudio[];
+void adalight();
+
+// True while the adalight effect is the one running
+boolean adalightRunning() {
+  functionList *list = audioEnabled ? effectListAudio : effectListNoAudio;
+  return list[currentEffect] == adalight;
+}
+
+// Switch to the adalight effect if it is in the current effect list
+void adalightSelect() {
+  functionList *list = audioEnabled ? effectListAudio : effectListNoAudio;
+  for (byte i = 0; i < numEffects; i++) {
+    if (list[i] == adalight) {
+      currentEffect = i;
+      effectInit = false;
+      audioActive = false;
+      fadeActive = 0;
+      return;
+    }
+  }
+}
+
+// Feed one received byte through the protocol, false if it isn't part of a frame
+boolean adalightByte(byte data) {
+  if (adaState != 0 && currentMillis - adaByteMillis > ADALIGHTSTALL) adaState = 0;
+  adaByteMillis = currentMillis;
+  switch (adaState) {
+    case 0:
+      if (data != 'A') return false;
+      adaState++;
+      return true;
+    case 1:
+      if (data != 'd') break;
+      adaState++;
+      return true;
+    case 2:
+      if (data != 'a') break;
+      adaState++;
+      return true;
+    case 3:
+      adaCountHigh = data;
+      adaState++;
+      return true;
+    case 4:
+      adaCountLow = data;
+      adaState++;
+      return true;
+    case 5:
+      if (data != (adaCountHigh ^ adaCountLow ^ 0x55)) break;
+      adaRemaining = (((uint16_t)adaCountHigh << 8 | adaCountLow) + 1) * 3;
+      adaIndex = 0;
+      adaState++;
+      if (!adalightRunning()) adalightSelect();
+      return true;
+    default:
+      if (adalightRunning() && adaIndex < (LAST_VISIBLE_LED + 1) * 3) {
+        ((byte *)leds)[adaIndex++] = data;
+      }
+      if (--adaRemaining == 0) {
+        adaState = 0;
+        if (adalightRunning()) {
+          FastLED.show();
+          adalightMillis = currentMillis;
+        }
+      }
+      return true;
+  }
+
+  // not the header after all: start again with this byte, which may begin
+  // the next header or be a command
+  adaState = 0;
+  return adalightByte(data);
+}
+
+// Effect list entry: holds the shades while a host is sending frames
+void adalight() {
+  if (effectInit == false) {
+    effectInit = true;
+    effectDelay = 100;
+    fadeActive = 0;
+    adalightMillis = currentMillis;
+    if (adaState == 0) {
+      fillAll(CRGB::Black); // reached by cycling, nothing coming in yet
+      FastLED.show();
+    }
+  }
+
+  cycleMillis = currentMillis; // no auto cycling while a host is in control
+
+  if (currentMillis - adalightMillis > ADALIGHTTIMEOUT) {
+    if (++currentEffect >= numEffects) currentEffect = 0;
+    effectInit = false;
+  }
+}
+
+#else
+
+#define adalightRunning() false
+
+#endif
@@ -0,0 +1,60 @@
+// Animations
+//
+// Effects baked into flash by tools/bake.py from what the host runner drew.
+// Each frame is a row of control bytes over LEDs 0..LAST_VISIBLE_LED, coded
+// against the frame before:
+//   0x00-0x7F  skip c+1 LEDs, they keep their colour
+//   0x80-0xBF  (c & 0x3F)+1 LEDs, each followed by its palette index
+//   0xC0-0xFF  (c & 0x3F)+1 LEDs, all the one palette index that follows
+// The first frame never skips, so the last frame can loop straight back to
+// it. The palette is up to 256 RGB triples, also in flash. Playing takes no
+// RAM past a pointer and a frame count, and a frame costs about as much as
+// filling the LEDs with a colour.
+
+struct Animation {
+  const byte *data;    // frames, PROGMEM
+  const byte *palette; // RGB triples, PROGMEM
+  uint16_t frames;
+  uint16_t delay;      // effectDelay to play at
+};
+
+inline CRGB animationColor(const byte *palette, byte index) {
+  const byte *rgb = palette + index * 3;
+  return CRGB(pgm_read_byte(rgb), pgm_read_byte(rgb + 1), pgm_read_byte(rgb + 2));
+}
+
+// An effect that plays a baked animation, in a loop. The Animation is in PROGMEM too.
+void playAnimation(const Animation *animation) {
+  static const byte *position;
+  static uint16_t frame;
+
+  // startup tasks
+  if (effectInit == false) {
+    effectInit = true;
+    effectDelay = pgm_read_word(&animation->delay);
+    fadeActive = 0;
+    fillAll(CRGB::Black);
+    frame = 0;
+  }
+
+  if (frame == 0) position = (const byte *)pgm_read_word(&animation->data);
+  const byte *palette = (const byte *)pgm_read_word(&animation->palette);
+
+  byte i = 0;
+  while (i <= LAST_VISIBLE_LED) {
+    byte c = pgm_read_byte(position++);
+    if (c < 0x80) {
+      i += c + 1;
+      continue;
+    }
+    byte count = (c & 0x3F) + 1;
+    if (c < 0xC0) {
+      while (count--) leds[i++] = animationColor(palette, pgm_read_byte(position++));
+    } else {
+      CRGB color = animationColor(palette, pgm_read_byte(position++));
+      while (count--) leds[i++] = color;
+    }
+  }
+
+  if (++frame >= pgm_read_word(&animation->frames)) frame = 0;
+}
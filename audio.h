@@ -7,23 +7,34 @@
 #define STROBEPIN 8
 #define RESETPIN 7
 
-// Smooth/average settings
-#define SPECTRUMSMOOTH 0.1
-#define PEAKDECAY 0.05
-#define NOISEFLOOR 65
+// Smooth/average settings (SPECTRUMSMOOTH, PEAKDECAY, NOISEFLOOR) and
+// AGCSMOOTH are in params.h
 
 // AGC settings
-#define AGCSMOOTH 0.004
 #define GAINUPPERLIMIT 20.0
 #define GAINLOWERLIMIT 0.1
 
 // Global variables
 unsigned int spectrumValue[7];  // holds raw adc values
-float spectrumDecay[7] = {0};   // holds time-averaged values
-float spectrumPeaks[7] = {0};   // holds peak values
+uint16_t spectrumDecay[7] = {0}; // holds time-averaged values
+uint16_t spectrumDecayFine[7] = {0}; // the same in 1/16ths, so small changes still move it
+uint16_t spectrumPeaks[7] = {0}; // holds peak values
 float audioAvg = 300.0;
 float gainAGC = 1.0;
 
+#ifdef DETERMINISTIC
+// Repeatable stand-in for the MSGEQ7: a 120 BPM kick in the two lowest bands
+// and slow swells in the others, driven by the loop counter
+unsigned int syntheticSpectrum(byte band) {
+  unsigned int beatPhase = currentMillis % 500;
+  if (band < 2) {
+    if (beatPhase < 150) return 950 - beatPhase * 4;
+    return 250;
+  }
+  return 150 + sin8(currentMillis / 20 + band * 40) * 2 + (beatPhase < 60 ? 120 : 0);
+}
+#endif
+
 void doAnalogs() {
 
   static PROGMEM const byte spectrumFactors[7] = {6, 8, 8, 8, 7, 7, 10};
@@ -46,7 +57,11 @@ void doAnalogs() {
     delayMicroseconds(25); // allow the output to settle
 
     // read the analog value
+#ifdef DETERMINISTIC
+    spectrumValue[i] = syntheticSpectrum(i);
+#else
     spectrumValue[i] = (analogRead(ANALOGPIN)+analogRead(ANALOGPIN)+analogRead(ANALOGPIN))/3;
+#endif
     digitalWrite(STROBEPIN, HIGH);
     delayMicroseconds(30);
 
@@ -67,18 +82,22 @@ void doAnalogs() {
     // apply current gain value
     spectrumValue[i] *= gainAGC;
 
-    // process time-averaged values
-    spectrumDecay[i] = (1.0 - SPECTRUMSMOOTH) * spectrumDecay[i] + SPECTRUMSMOOTH * spectrumValue[i];
+    // process time-averaged values, kept as integers so the effects can do
+    // without floating point, in 1/16ths so they still reach a level that is
+    // only a few counts off (levels over 4095 count as 4095)
+    long target = (long)(spectrumValue[i] < 4096 ? spectrumValue[i] : 4095) << 4;
+    spectrumDecayFine[i] += (target - spectrumDecayFine[i]) * PARAMFIXED(SPECTRUMSMOOTH, 12) >> 12;
+    spectrumDecay[i] = (spectrumDecayFine[i] + 8) >> 4;
 
     // process peak values
     if (spectrumPeaks[i] < spectrumDecay[i]) spectrumPeaks[i] = spectrumDecay[i];
-    spectrumPeaks[i] = spectrumPeaks[i] * (1.0 - PEAKDECAY);
+    spectrumPeaks[i] -= ((long)spectrumPeaks[i] * PARAMFIXED(PEAKDECAY, 16) + 0xFFFF) >> 16;
 
 
   }
 
   // Calculate audio levels for automatic gain
-  audioAvg = (1.0 - AGCSMOOTH) * audioAvg + AGCSMOOTH * (analogsum / 7.0);
+  audioAvg += (analogsum / 7.0 - audioAvg) * PARAMFIXED(AGCSMOOTH, 16) * (1.0 / 65536);
 
   // Calculate gain adjustment factor
   gainAGC = 300.0 / audioAvg;
@@ -89,24 +108,37 @@ void doAnalogs() {
 }
 
 // Attempt at beat detection
+// Levels are fixed point, 1/256ths, so effects calling this stay free of floating point
 byte beatTriggered = 0;
-#define beatLevel 25.0
-#define beatDeadzone 35.0
-#define beatDelay 50
-float lastBeatVal = 0;
+#define beatDelay 50 // beatLevel and beatDeadzone are in params.h
+long lastBeatVal = 0;
+long beatAvg = 0;
+unsigned long lastBeatMillis = 0;
+#ifdef SHOW
+#define SHOWNOBEATS 255
+byte showBeats = SHOWNOBEATS; // 1 when a playing show (show.h) has cued a beat not taken yet
+#endif
 byte beatDetect() {
-  static float beatAvg = 0;
-  static unsigned long lastBeatMillis;
-  float specCombo = (spectrumDecay[0] + spectrumDecay[1]) / 2.0;
-  beatAvg = (1.0 - AGCSMOOTH) * beatAvg + AGCSMOOTH * specCombo;
+#ifdef SHOW
+  if (showBeats != SHOWNOBEATS) {
+    byte beat = showBeats;
+    showBeats = 0;
+    return beat;
+  }
+#endif
+  long specCombo = ((long)spectrumDecay[0] + spectrumDecay[1]) << 7; // the mean of the two
+  // both are under 2^20, so in 1/16ths the change times AGCSMOOTH (up to
+  // 2^14) still fits in 32 bits, int32_t so a host build overflows the same
+  int32_t change = constrain(specCombo - beatAvg, -0xFFFFFL, 0xFFFFFL);
+  beatAvg += (change >> 4) * (int32_t)PARAMFIXED(AGCSMOOTH, 16) >> 12;
   
   if (lastBeatVal < beatAvg) lastBeatVal = beatAvg;
-  if ((specCombo - beatAvg) > beatLevel && beatTriggered == 0 && currentMillis - lastBeatMillis > beatDelay) {
+  if ((specCombo - beatAvg) > PARAMFIXED(beatLevel, 8) && beatTriggered == 0 && currentMillis - lastBeatMillis > beatDelay) {
     beatTriggered = 1;
     lastBeatVal = specCombo;
     lastBeatMillis = currentMillis;
     return 1;
-  } else if ((lastBeatVal - specCombo) > beatDeadzone) {
+  } else if ((lastBeatVal - specCombo) > PARAMFIXED(beatDeadzone, 8)) {
     beatTriggered = 0;
     return 0;
   } else {
@@ -0,0 +1,21 @@
+// Baked animations for playAnimation(), see animation.h
+//
+// Written by tools/bake.py, e.g. tools/bake.py hearts --frames 50 >> baked.h
+// Rebake rather than edit; the effect they came from may be gone.
+
+// hearts, baked by tools/bake.py from hearts: 5 frames (one cycle), 5 colours
+// 145 bytes of flash
+const byte heartsFrames[] PROGMEM = {
+  237, 0, 130, 1, 0, 1, 195, 0, 130, 1, 0, 1, 195, 0, 128, 1,
+  195, 0, 130, 1, 0, 0, 30, 132, 2, 2, 0, 2, 2, 1, 132, 2,
+  2, 0, 2, 2, 2, 194, 2, 3, 194, 2, 3, 128, 2, 3, 128, 2,
+  1, 14, 132, 3, 3, 0, 3, 3, 3, 132, 3, 3, 0, 3, 3, 1,
+  196, 3, 1, 196, 3, 2, 194, 3, 3, 194, 3, 3, 128, 3, 3, 128,
+  3, 1, 132, 4, 4, 0, 4, 4, 3, 130, 4, 4, 0, 200, 4, 1,
+  198, 4, 0, 196, 4, 1, 196, 4, 2, 194, 4, 3, 194, 4, 3, 128,
+  4, 3, 128, 4, 1, 255, 0, 0, 194, 0,
+};
+const byte heartsPalette[] PROGMEM = {
+  0, 0, 0, 250, 128, 114, 255, 99, 71, 220, 20, 60, 255, 0, 0,
+};
+const Animation heartsAnimation PROGMEM = {heartsFrames, heartsPalette, 5, 150};
@@ -0,0 +1,171 @@
+#!/usr/bin/env python3
+"""Print simavr benchmark results and compare them against a baseline.
+
+    compare.py [--static-ram BYTES] results.csv
+    compare.py [--static-ram BYTES] --baseline baseline.csv [--threshold 5] results.csv
+
+Effect names are taken from the uncommented entries of effectListAudio[]
+and effectListNoAudio[] in RGBShadesAudio.ino. The "blend" rows are the
+blend modes of layers.h, one layerBlend() pass over a full layer each, the
+"particles" rows one update or render of a full particle pool, and the
+"palette" rows a palette lookup for every LED, or one cachePalette(), the
+"history" rows adding a spectrum history sample or reading its stats, and
+the "post" rows a blur or bloom of a full frame. A post row over POSTBUDGET
+(blur.h) is flagged and the exit status is 1. The "vm" rows are the
+bytecode programs of vm.h, each as assembled and then without its frame
+code, with their cycles as a multiple of the effect they copy; one whose
+frame and show take longer than 1/VMFPS s is flagged the same way. With
+--static-ram (.data, .bss and .noinit of the firmware), so is any row
+whose deepest stack reaches down into the static variables. With
+--baseline, any effect
+whose mean or max cycles per frame grew by more than the threshold
+(percent), or whose stack depth grew, is flagged the same way.
+"""
+
+import argparse
+import csv
+import glob
+import math
+import os
+import re
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "tools"))
+from sketch import ROOT, blend_modes, effect_lists
+
+F_CPU = 16000000
+RAM_SIZE = 2048 # ATmega328, 0x100 to RAMEND
+
+# the particle engine steps timed by particleBench() in particles.h
+PARTICLE_STEPS = ["update", "render", "render smooth"]
+
+# and the palette lookups timed by paletteBench() in utils.h
+PALETTE_STEPS = ["ColorFromPalette", "paletteColor", "paletteColor bright", "cachePalette"]
+
+# and the spectrum history, by historyBench() in history.h
+HISTORY_STEPS = ["historyPush", "mean/variance/RMS x7"]
+
+# and the post-processing stage, by blurBench() in blur.h
+POST_STEPS = ["blur", "bloom"]
+
+
+def vm_fps():
+    source = open(os.path.join(ROOT, "vm.h")).read()
+    return int(re.search(r"#define\s+VMFPS\s+(\d+)", source).group(1))
+
+
+def vm_programs():
+    """The built-in programs in vmdata.h order, named like the effects they copy."""
+    return [os.path.splitext(os.path.basename(p))[0] for p in sorted(glob.glob(os.path.join(ROOT, "tools", "vm", "*.vm")))]
+
+
+def post_budget():
+    source = open(os.path.join(ROOT, "blur.h")).read()
+    return int(re.search(r"#define\s+POSTBUDGET\s+(\d+)", source).group(1))
+
+
+def effect_names():
+    names = {}
+    for setname, entries in effect_lists(bench=True).items():
+        for i, name in enumerate(entries):
+            names[(setname, i)] = name
+    for i, name in enumerate(blend_modes()):
+        names[("blend", i)] = name
+    for i, name in enumerate(PARTICLE_STEPS):
+        names[("particles", i)] = name
+    for i, name in enumerate(PALETTE_STEPS):
+        names[("palette", i)] = name
+    for i, name in enumerate(HISTORY_STEPS):
+        names[("history", i)] = name
+    for i, name in enumerate(POST_STEPS):
+        names[("post", i)] = name
+    for i, name in enumerate(vm_programs()):
+        names[("vm", i * 2)] = name + " vm"
+        names[("vm", i * 2 + 1)] = name + " vm flat"
+    return names
+
+
+def load(path):
+    rows = {}
+    with open(path) as f:
+        for row in csv.DictReader(f):
+            key = (row["set"], int(row["index"]))
+            rows[key] = {k: float(v) for k, v in row.items() if k not in ("set", "index")}
+    return rows
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("results")
+    parser.add_argument("--baseline")
+    parser.add_argument("--threshold", type=float, default=5.0)
+    parser.add_argument("--static-ram", type=int)
+    args = parser.parse_args()
+
+    names = effect_names()
+    budget = post_budget()
+    vm_budget = F_CPU // vm_fps()
+    native = {}
+    for key, name in names.items():
+        if key[0] == "noaudio":
+            native[name] = key
+    results = load(args.results)
+    baseline = load(args.baseline) if args.baseline else {}
+
+    print("%-8s %-20s %10s %10s %10s %8s %8s %8s %8s %6s %6s" % (
+        "set", "effect", "eff_min", "eff_mean", "eff_max", "analogs", "fade", "post", "show", "stack", "delay"))
+
+    regressions = 0
+    deepest = 0
+    for key in sorted(results):
+        r = results[key]
+        name = names.get(key, "#%d" % key[1])
+
+        # shortest effectDelay (ms) at which a frame, its fade and show still fit
+        frame = r["effect_mean"] + r["show_mean"] + (r["fade_mean"] if r["fade_calls"] else 0)
+        frame += r.get("post_mean", 0) if r.get("post_calls") else 0
+        delay = math.ceil(frame * 1000.0 / F_CPU) if key[0] in ("audio", "noaudio") else 0
+
+        flag = ""
+        if key[0] == "post" and r["effect_max"] > budget:
+            flag += "  OVER BUDGET %d" % budget
+            regressions += 1
+        if key[0] == "vm":
+            # the sweep doesn't show a frame of its own, take the copied effect's show
+            copied = results.get(native.get(name.split()[0]))
+            show = copied["show_mean"] if copied else 0
+            if copied and copied["effect_mean"]:
+                flag += "  %.2fx" % (r["effect_mean"] / copied["effect_mean"])
+            if r["effect_max"] + show > vm_budget:
+                flag += "  UNDER %d FPS" % vm_fps()
+                regressions += 1
+        deepest = max(deepest, r["stack_max"])
+        if args.static_ram is not None and args.static_ram + r["stack_max"] >= RAM_SIZE:
+            flag += "  STACK INTO STATIC RAM"
+            regressions += 1
+        b = baseline.get(key)
+        if b:
+            limit = 1.0 + args.threshold / 100.0
+            if r["effect_mean"] > b["effect_mean"] * limit or r["effect_max"] > b["effect_max"] * limit:
+                flag += "  REGRESSION cycles %+.1f%%" % (100.0 * (r["effect_mean"] / b["effect_mean"] - 1) if b["effect_mean"] else 0)
+            if r["stack_max"] > b["stack_max"]:
+                flag += "  REGRESSION stack %+d" % (r["stack_max"] - b["stack_max"])
+            if flag and "REGRESSION" in flag:
+                regressions += 1
+
+        print("%-8s %-20s %10d %10d %10d %8d %8d %8d %8d %6d %6d%s" % (
+            key[0], name, r["effect_min"], r["effect_mean"], r["effect_max"],
+            r["analogs_mean"], r["fade_mean"], r.get("post_mean", 0), r["show_mean"], r["stack_max"], delay, flag))
+
+    if args.static_ram is not None:
+        print("%d bytes of static RAM, deepest stack %d, %d bytes to spare" % (
+            args.static_ram, deepest, RAM_SIZE - args.static_ram - deepest))
+    if args.baseline:
+        print("%d regression(s) against %s" % (regressions, args.baseline))
+    elif regressions:
+        print("%d row(s) over budget" % regressions)
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,92 @@
+#!/usr/bin/env python3
+"""Fail if any of the given effects can reach floating point code.
+
+    floatcheck.py [--objdump avr-objdump] firmware.elf effect...
+
+The ATmega328 has no FPU, so float arithmetic is done by calls into libgcc
+(__addsf3, __mulsf3, __fixsfsi...) and libm (sqrt, hypot...), a few hundred
+cycles each. This disassembles the firmware, follows direct calls and jumps
+from each effect and lists the path to every float routine it can reach.
+Calls through function pointers are not followed. An effect that isn't in
+the firmware fails the check: the BENCHMARK build links the FLOATFREE
+effects left out of the effect lists (see RGBShadesAudio.ino).
+"""
+
+import argparse
+import re
+import subprocess
+import sys
+
+FLOAT_ROUTINE = re.compile(
+    r"^(__[a-z]*(sf|df)[a-z]*\d?|__fp_\w+|(sqrt|hypot|sin|cos|tan|atan2?|exp|log|pow|floor|ceil|round|lround|fabs|fmod)f?)$")
+HEADER = re.compile(r"^[0-9a-f]+ <(.+)>:$")
+CALL = re.compile(r"\b(r?call|r?jmp|jmp|call)\b.*<([^>+]+)(\+0x[0-9a-f]+)?>")
+
+
+def plain(name):
+    """Function name without arguments or PLT suffix: "drawVU()" -> "drawVU"."""
+    return name.split("(")[0].split("@")[0]
+
+
+def call_graph(objdump, elf):
+    output = subprocess.run([objdump, "-d", "-C", elf], check=True, capture_output=True, text=True).stdout
+    graph = {}
+    current = None
+    for line in output.splitlines():
+        m = HEADER.match(line)
+        if m:
+            current = plain(m.group(1))
+            graph.setdefault(current, set())
+            continue
+        m = CALL.search(line)
+        if m and current:
+            target = plain(m.group(2))
+            if target != current:
+                graph[current].add(target)
+    return graph
+
+
+def float_paths(graph, root):
+    """Shortest call path from root to each float routine it reaches."""
+    paths = []
+    seen = {root: [root]}
+    queue = [root]
+    while queue:
+        name = queue.pop(0)
+        for target in sorted(graph.get(name, ())):
+            if target in seen:
+                continue
+            seen[target] = seen[name] + [target]
+            if FLOAT_ROUTINE.match(target):
+                paths.append(seen[target])
+            else:
+                queue.append(target)
+    return paths
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--objdump", default="avr-objdump")
+    parser.add_argument("elf")
+    parser.add_argument("effects", nargs="*")
+    args = parser.parse_args()
+
+    graph = call_graph(args.objdump, args.elf)
+    failed = False
+    for effect in args.effects:
+        if effect not in graph:
+            print("%s: not in the firmware" % effect)
+            failed = True
+            continue
+        paths = float_paths(graph, effect)
+        if paths:
+            failed = True
+            for path in paths:
+                print("%s: float code %s" % (effect, " -> ".join(path)))
+        else:
+            print("%s: no float code" % effect)
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,261 @@
+// Cycle-accurate effect benchmark for the RGB Shades under simavr
+//
+// Runs a firmware built with -DBENCHMARK (see timing.h) on a simulated
+// 16 MHz ATmega328P. The firmware marks each loop() stage by writing to
+// GPIOR0 and names the running effect in GPIOR1; this runner timestamps
+// those writes with the cycle counter and tracks the stack pointer after
+// every instruction. The MSGEQ7 is modelled on the strobe/reset pins and
+// fed from a canned spectrum file, one row of seven 10-bit values per
+// doAnalogs() call.
+//
+//   simavr_bench [-s spectrum.txt] [-c max_cycles] firmware.elf > results.csv
+//
+// Output is one CSV row per effect, see the header line for the columns.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "sim_avr.h"
+#include "sim_elf.h"
+#include "sim_io.h"
+#include "avr_adc.h"
+#include "avr_ioport.h"
+
+// data-space addresses on the ATmega328P
+#define GPIOR0_ADDR 0x3E
+#define GPIOR1_ADDR 0x4A
+#define RAMEND 0x8FF
+
+// RGB Shades wiring (see audio.h and buttons.h)
+#define STROBE_PORT 'B'
+#define STROBE_BIT 0
+#define RESET_PORT 'D'
+#define RESET_BIT 7
+#define ANALOG_CHANNEL ADC_IRQ_ADC3
+
+// timing.h stage ids
+#define NUMSTAGES 8
+#define STAGE_ANALOGS 3
+#define STAGE_EFFECT 4
+#define STAGE_FADE 5
+#define STAGE_SHOW 6
+#define STAGE_POST 7
+#define BENCH_END 0x40
+#define BENCH_DONE 0xFF
+#define BENCH_BLEND 0x40
+#define BENCH_PARTICLES 0x50
+#define BENCH_PALETTE 0x60
+#define BENCH_HISTORY 0x70
+#define BENCH_POST 0xC0
+#define BENCH_VM 0xD0
+
+#define MAX_EFFECTS 256
+#define MAX_ROWS 4096
+
+typedef struct {
+  uint64_t calls;
+  uint64_t total;
+  uint64_t min;
+  uint64_t max;
+} stat_t;
+
+typedef struct {
+  int used;
+  stat_t stage[NUMSTAGES];
+  uint16_t minSP;
+} effect_t;
+
+static avr_t *avr;
+static effect_t effects[MAX_EFFECTS];
+static uint8_t currentEffect = 0x80;
+static uint64_t stageStart[NUMSTAGES];
+static int done = 0;
+
+static uint16_t spectrum[MAX_ROWS][7];
+static int spectrumRows = 0;
+static int spectrumRow = 0;
+static int band = -1;
+static uint8_t strobeLevel = 1;
+
+static void statAdd(stat_t *s, uint64_t v) {
+  if (s->calls == 0 || v < s->min) s->min = v;
+  if (v > s->max) s->max = v;
+  s->total += v;
+  s->calls++;
+}
+
+static void gpior0Write(struct avr_t *avr, avr_io_addr_t addr, uint8_t v, void *param) {
+  avr->data[addr] = v;
+
+  if (v == BENCH_DONE) {
+    done = 1;
+    return;
+  }
+
+  uint8_t stage = v & ~BENCH_END;
+  if (stage >= NUMSTAGES) return;
+
+  if (v & BENCH_END) {
+    effect_t *e = &effects[currentEffect];
+    e->used = 1;
+    statAdd(&e->stage[stage], avr->cycle - stageStart[stage]);
+  } else {
+    stageStart[stage] = avr->cycle;
+  }
+}
+
+static void gpior1Write(struct avr_t *avr, avr_io_addr_t addr, uint8_t v, void *param) {
+  avr->data[addr] = v;
+  currentEffect = v;
+}
+
+// MSGEQ7: reset returns to the first band, each strobe falling edge presents the next band
+static void resetPin(struct avr_irq_t *irq, uint32_t value, void *param) {
+  if (value) {
+    band = -1;
+    if (spectrumRows && ++spectrumRow >= spectrumRows) spectrumRow = 0;
+  }
+}
+
+static void strobePin(struct avr_irq_t *irq, uint32_t value, void *param) {
+  if (!value && strobeLevel) {
+    if (++band > 6) band = 0;
+  }
+  strobeLevel = value ? 1 : 0;
+}
+
+// called when the firmware starts a conversion, present the current band in millivolts
+static void adcTrigger(struct avr_irq_t *irq, uint32_t value, void *param) {
+  uint32_t level = 0;
+  if (band >= 0 && spectrumRows) level = spectrum[spectrumRow][band];
+  avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_ADC_GETSIG, ANALOG_CHANNEL), level * 5000 / 1023);
+}
+
+static int loadSpectrum(const char *path) {
+  FILE *f = fopen(path, "r");
+  if (!f) {
+    perror(path);
+    return 0;
+  }
+  char line[256];
+  while (spectrumRows < MAX_ROWS && fgets(line, sizeof(line), f)) {
+    unsigned v[7];
+    if (line[0] == '#') continue;
+    if (sscanf(line, "%u %u %u %u %u %u %u", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6]) != 7) continue;
+    for (int i = 0; i < 7; i++) spectrum[spectrumRows][i] = v[i] > 1023 ? 1023 : v[i];
+    spectrumRows++;
+  }
+  fclose(f);
+  return spectrumRows;
+}
+
+static double mean(const stat_t *s) {
+  return s->calls ? (double)s->total / s->calls : 0;
+}
+
+int main(int argc, char **argv) {
+  const char *spectrumPath = "spectrum.txt";
+  uint64_t maxCycles = 16000000ULL * 600;
+  const char *elfPath = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+      spectrumPath = argv[++i];
+    } else if (!strcmp(argv[i], "-c") && i + 1 < argc) {
+      maxCycles = strtoull(argv[++i], NULL, 0);
+    } else {
+      elfPath = argv[i];
+    }
+  }
+  if (!elfPath) {
+    fprintf(stderr, "usage: %s [-s spectrum.txt] [-c max_cycles] firmware.elf\n", argv[0]);
+    return 2;
+  }
+  if (!loadSpectrum(spectrumPath)) return 1;
+
+  elf_firmware_t fw;
+  memset(&fw, 0, sizeof(fw));
+  if (elf_read_firmware(elfPath, &fw) != 0) {
+    fprintf(stderr, "%s: could not read firmware\n", elfPath);
+    return 1;
+  }
+
+  avr = avr_make_mcu_by_name("atmega328p");
+  if (!avr) {
+    fprintf(stderr, "simavr has no atmega328p core\n");
+    return 1;
+  }
+  avr_init(avr);
+  avr_load_firmware(avr, &fw);
+  avr->frequency = 16000000;
+  avr->vcc = avr->avcc = avr->aref = 5000;
+
+  avr_register_io_write(avr, GPIOR0_ADDR, gpior0Write, NULL);
+  avr_register_io_write(avr, GPIOR1_ADDR, gpior1Write, NULL);
+  avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ(RESET_PORT), RESET_BIT), resetPin, NULL);
+  avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ(STROBE_PORT), STROBE_BIT), strobePin, NULL);
+  avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_ADC_GETSIG, ADC_IRQ_OUT_TRIGGER), adcTrigger, NULL);
+
+  // buttons are released: hold both inputs high
+  avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('D'), 3), 1);
+  avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('D'), 4), 1);
+
+  for (int i = 0; i < MAX_EFFECTS; i++) effects[i].minSP = RAMEND;
+
+  int state = cpu_Running;
+  while (!done && state != cpu_Done && state != cpu_Crashed && avr->cycle < maxCycles) {
+    state = avr_run(avr);
+    uint16_t sp = avr->data[R_SPL] | (avr->data[R_SPH] << 8);
+    if (sp < effects[currentEffect].minSP) effects[currentEffect].minSP = sp;
+  }
+
+  if (!done) {
+    fprintf(stderr, "benchmark did not finish (state %d after %llu cycles)\n", state, (unsigned long long)avr->cycle);
+    return 1;
+  }
+
+  printf("set,index,frames,effect_min,effect_mean,effect_max,analogs_calls,analogs_mean,"
+         "fade_calls,fade_mean,show_calls,show_mean,post_calls,post_mean,stack_max\n");
+  for (int i = 0; i < MAX_EFFECTS; i++) {
+    effect_t *e = &effects[i];
+    if (!e->used || !e->stage[STAGE_EFFECT].calls) continue;
+    const char *set = "noaudio";
+    int index = i;
+    if ((i & 0xF0) == BENCH_VM) {
+      set = "vm";
+      index = i & 0x0F;
+    } else if ((i & BENCH_POST) == BENCH_POST) {
+      set = "post";
+      index = i & 0x0F;
+    } else if (i & 0x80) {
+      set = "audio";
+      index = i & 0x7F;
+    } else if ((i & 0x70) == BENCH_HISTORY) {
+      set = "history";
+      index = i & 0x0F;
+    } else if ((i & 0x70) == BENCH_PALETTE) {
+      set = "palette";
+      index = i & 0x0F;
+    } else if ((i & BENCH_PARTICLES) == BENCH_PARTICLES) {
+      set = "particles";
+      index = i & 0x0F;
+    } else if (i & BENCH_BLEND) {
+      set = "blend";
+      index = i & 0x0F;
+    }
+    printf("%s,%d,%llu,%llu,%.0f,%llu,%llu,%.0f,%llu,%.0f,%llu,%.0f,%llu,%.0f,%u\n",
+           set, index,
+           (unsigned long long)e->stage[STAGE_EFFECT].calls,
+           (unsigned long long)e->stage[STAGE_EFFECT].min, mean(&e->stage[STAGE_EFFECT]),
+           (unsigned long long)e->stage[STAGE_EFFECT].max,
+           (unsigned long long)e->stage[STAGE_ANALOGS].calls, mean(&e->stage[STAGE_ANALOGS]),
+           (unsigned long long)e->stage[STAGE_FADE].calls, mean(&e->stage[STAGE_FADE]),
+           (unsigned long long)e->stage[STAGE_SHOW].calls, mean(&e->stage[STAGE_SHOW]),
+           (unsigned long long)e->stage[STAGE_POST].calls, mean(&e->stage[STAGE_POST]),
+           RAMEND - e->minSP);
+  }
+
+  return 0;
+}
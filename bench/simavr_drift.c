@@ -0,0 +1,128 @@
+// Clock drift test for the RGB Shades under simavr
+//
+// Runs a firmware built with -DDRIFTTEST (see clock.h) on a simulated
+// 16 MHz ATmega328P with the normal effects cycling. Once a second the
+// firmware reads millis() and clockMillis() and writes each value to GPIOR2
+// after a tag byte; this runner compares them with the cycle count at the
+// tag and prints how far each clock is from real time once a minute.
+//
+//   simavr_drift [-s seconds] firmware.elf
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "sim_avr.h"
+#include "sim_elf.h"
+#include "sim_io.h"
+#include "avr_ioport.h"
+
+// data-space address of GPIOR2 on the ATmega328P
+#define GPIOR2_ADDR 0x4B
+
+#define FREQUENCY 16000000ULL
+
+// clock.h tags
+#define DRIFTMILLIS 1
+#define DRIFTCLOCK 2
+
+static uint8_t tag = 0;
+static int bytesLeft = 0;
+static uint32_t value;
+static uint64_t tagCycle;
+
+// last reading of each clock and the cycle it was taken at
+static uint64_t sampleCycle[3];
+static uint32_t sampleValue[3];
+static int sampled[3];
+
+// offsets at the first reading, so the time before loop() starts doesn't count
+static double firstError[3];
+
+static double errorMs(int clock) {
+  return sampleValue[clock] - sampleCycle[clock] * 1000.0 / FREQUENCY;
+}
+
+static void gpior2Write(struct avr_t *avr, avr_io_addr_t addr, uint8_t v, void *param) {
+  avr->data[addr] = v;
+
+  if (bytesLeft == 0) {
+    if (v != DRIFTMILLIS && v != DRIFTCLOCK) return;
+    tag = v;
+    tagCycle = avr->cycle;
+    value = 0;
+    bytesLeft = 4;
+    return;
+  }
+
+  value |= (uint32_t)v << (8 * (4 - bytesLeft));
+  if (--bytesLeft) return;
+
+  sampleCycle[tag] = tagCycle;
+  sampleValue[tag] = value;
+  if (!sampled[tag]) {
+    firstError[tag] = errorMs(tag);
+    sampled[tag] = 1;
+  }
+}
+
+int main(int argc, char **argv) {
+  unsigned seconds = 600;
+  const char *elfPath = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+      seconds = strtoul(argv[++i], NULL, 0);
+    } else {
+      elfPath = argv[i];
+    }
+  }
+  if (!elfPath) {
+    fprintf(stderr, "usage: %s [-s seconds] firmware.elf\n", argv[0]);
+    return 2;
+  }
+
+  elf_firmware_t fw;
+  memset(&fw, 0, sizeof(fw));
+  if (elf_read_firmware(elfPath, &fw) != 0) {
+    fprintf(stderr, "%s: could not read firmware\n", elfPath);
+    return 1;
+  }
+
+  avr_t *avr = avr_make_mcu_by_name("atmega328p");
+  if (!avr) {
+    fprintf(stderr, "simavr has no atmega328p core\n");
+    return 1;
+  }
+  avr_init(avr);
+  avr_load_firmware(avr, &fw);
+  avr->frequency = FREQUENCY;
+  avr->vcc = avr->avcc = avr->aref = 5000;
+
+  avr_register_io_write(avr, GPIOR2_ADDR, gpior2Write, NULL);
+
+  // buttons are released: hold both inputs high
+  avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('D'), 3), 1);
+  avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('D'), 4), 1);
+
+  printf("minute,millis_error_ms,clock_error_ms\n");
+  int state = cpu_Running;
+  for (unsigned minute = 1; minute * 60 <= seconds; minute++) {
+    uint64_t until = minute * 60 * FREQUENCY;
+    while (state != cpu_Done && state != cpu_Crashed && avr->cycle < until) state = avr_run(avr);
+    if (state == cpu_Done || state == cpu_Crashed) {
+      fprintf(stderr, "firmware stopped (state %d after %llu cycles)\n", state, (unsigned long long)avr->cycle);
+      return 1;
+    }
+    if (!sampled[DRIFTMILLIS] || !sampled[DRIFTCLOCK]) {
+      fprintf(stderr, "no clock readings, was the firmware built with -DDRIFTTEST?\n");
+      return 1;
+    }
+    printf("%u,%.1f,%.1f\n", minute,
+           errorMs(DRIFTMILLIS) - firstError[DRIFTMILLIS], errorMs(DRIFTCLOCK) - firstError[DRIFTCLOCK]);
+    fflush(stdout);
+  }
+
+  return 0;
+}
@@ -0,0 +1,83 @@
+// Blur and bloom
+//
+// A post-processing stage that runs once a frame, after the effect has drawn
+// and before show(). Blur spreads part of each LED to its neighbours, a row
+// at a time and then a column at a time. Bloom adds the light above a
+// threshold to the neighbours instead, so bright spots glow. Both run along
+// the blurRows and blurColumns lines in pathdata.h, which stop at the bridge
+// and the corners. Blur keeps what would have gone into a missing LED, so
+// no light is lost at the edges. Each line is done in place: the share
+// passed back to the LED before rides along in a carry, so there's no
+// second frame buffer.
+//
+// Effects set blurAmount or bloomAmount (0-255, about the share of an LED
+// that spreads) in their startup tasks. loop() clears them for each new
+// effect.
+//
+// Budget: POSTBUDGET cycles for blur and bloom together over all 68 LEDs.
+// bench/compare.py fails the "post" bench rows if they go over.
+
+#define POSTBUDGET 16000 // cycles, 1 ms
+
+byte blurAmount = 0;
+byte bloomAmount = 0;
+byte bloomThreshold = 128;
+
+// Lines are a length and that many LEDs, until a length of 0
+void postLines(const byte *lines, byte amount, byte threshold, boolean bloom) {
+  byte half = amount >> 1;
+  CRGB floor(threshold, threshold, threshold);
+  byte count;
+  while ((count = pgm_read_byte(lines++))) {
+    CRGB carry = CRGB::Black;
+    byte previous = 0;
+    for (byte n = 0; n < count; n++) {
+      byte i = pgm_read_byte(lines++);
+      CRGB led = leds[i];
+      CRGB part = led;
+      if (bloom) part -= floor;
+      part.nscale8(half);
+      if (n) {
+        leds[previous] += part;
+        if (!bloom) led -= part;
+      }
+      if (!bloom && n + 1 < count) led -= part;
+      led += carry;
+      leds[i] = led;
+      carry = part;
+      previous = i;
+    }
+  }
+}
+
+void blurLeds(byte amount) {
+  postLines(blurRows, amount, 0, false);
+  postLines(blurColumns, amount, 0, false);
+}
+
+void bloomLeds(byte amount, byte threshold) {
+  postLines(blurRows, amount, threshold, true);
+  postLines(blurColumns, amount, threshold, true);
+}
+
+// Called by loop() after every effect frame
+void postProcess() {
+  if (blurAmount) blurLeds(blurAmount);
+  if (bloomAmount) bloomLeds(bloomAmount, bloomThreshold);
+}
+
+#ifdef BENCHMARK
+// Time blurLeds() and bloomLeds() over a full frame, as BENCH_POST + 0 and 1
+void blurBench() {
+  for (byte step = 0; step < 2; step++) {
+    GPIOR1 = BENCH_POST | step;
+    for (uint16_t i = 0; i < BENCH_FRAMES; i++) {
+      for (byte j = 0; j <= LAST_VISIBLE_LED; j++) leds[j] = CHSV(j * 5 + i, 255, 255);
+      STAGE_BEGIN(STAGE_EFFECT);
+      if (step == 0) blurLeds(128);
+      else bloomLeds(128, 128);
+      STAGE_END(STAGE_EFFECT);
+    }
+  }
+}
+#endif
@@ -1,153 +1,332 @@
 // Process button inputs and return button activity
+//
+// A pin change interrupt timestamps every edge on the buttons into a small
+// queue, so presses are caught however long loop() is busy and their timing
+// doesn't depend on when loop() gets to them. updateButtons() debounces the
+// queued edges and turns them into events for doButtons():
+//
+//   BTNCLICK        pressed and released before BTNLONGPRESSTIME
+//   BTNDOUBLECLICK  two clicks within BTNDOUBLECLICKTIME, only for the buttons
+//                   in BTNDOUBLECLICKS (their single clicks are reported when
+//                   the time is up, the others' right away)
+//   BTNLONGPRESS    held for BTNLONGPRESSTIME
+//   BTNCHORD        both buttons down together, nothing else is reported
+//                   until both are released
 
 #define NUMBUTTONS 2
 #define MODEBUTTON 4
 #define BRIGHTNESSBUTTON 3
 
+// events
+#define BTNNONE 0
+#define BTNCLICK 1
+#define BTNDOUBLECLICK 2
+#define BTNLONGPRESS 3
+#define BTNCHORD 4
+
+// per button states
 #define BTNIDLE 0
-#define BTNDEBOUNCING 1
-#define BTNPRESSED 2
-#define BTNRELEASED 3
-#define BTNLONGPRESS 4
-#define BTNLONGPRESSREAD 5
-#define BTNGUARDTIME 6
+#define BTNPRESSED 1
+#define BTNLONGHELD 2
+#define BTNCLICKED 3     // released, a second click may follow
+#define BTNSECONDPRESS 4 // down again within BTNDOUBLECLICKTIME
+#define BTNGUARDTIME 5   // after a chord, until both are released
 
 #define BTNDEBOUNCETIME 30
 #define BTNLONGPRESSTIME 1500
+#define BTNDOUBLECLICKTIME 250
+#ifdef SHOW
+#define BTNDOUBLECLICKS 0x03 // bit per button, SW2 starts a show
+#else
+#define BTNDOUBLECLICKS 0x01 // bit per button
+#endif
 
-unsigned long buttonEvents[NUMBUTTONS];
-byte buttonStatuses[NUMBUTTONS];
-byte buttonmap[NUMBUTTONS] = {BRIGHTNESSBUTTON, MODEBUTTON};
+#define BTNEDGES 8  // edge queue size, power of two
+#define BTNEVENTS 4 // event queue size, power of two
+
+// the clock the edges are timestamped with
+#ifdef DETERMINISTIC
+#define buttonClock() ((uint16_t)currentMillis)
+#else
+#define buttonClock() ((uint16_t)clockMillis())
+#endif
+
+const byte buttonmap[NUMBUTTONS] = {BRIGHTNESSBUTTON, MODEBUTTON};
 extern const byte numEffectsAudio;
 extern const byte numEffectsNoAudio;
+void standbyEnd();
 
+// Edges, written by the interrupt and read by updateButtons(): each side only
+// moves its own index, so neither has to block the other
+struct ButtonEdge {
+  uint16_t time;
+  byte button;
+  byte down;
+};
+volatile ButtonEdge buttonEdges[BTNEDGES];
+volatile byte buttonEdgeHead = 0;
+volatile boolean buttonEdgeLost = false;
+byte buttonEdgeTail = 0;
+byte buttonLevels; // bit per button, 1 = down, as last seen by the interrupt
 
+// Debouncing and the state machine
+byte buttonRaw[NUMBUTTONS];           // last queued level
+uint16_t buttonRawTime[NUMBUTTONS];   // when it changed
+byte buttonDown[NUMBUTTONS];          // debounced level
+byte buttonStatuses[NUMBUTTONS];
+uint16_t buttonStateTime[NUMBUTTONS]; // when the current state started
 
-void updateButtons() {
+byte buttonEventQueue[BTNEVENTS]; // button << 4 | event
+byte buttonEventHead = 0;
+byte buttonEventTail = 0;
+
+// Read the buttons and queue an edge for each one that changed
+void buttonEdge() {
   for (byte i = 0; i < NUMBUTTONS; i++) {
-    switch (buttonStatuses[i]) {
-      case BTNIDLE:
-        if (digitalRead(buttonmap[i]) == LOW) {
-          buttonEvents[i] = currentMillis;
-          buttonStatuses[i] = BTNDEBOUNCING;
-        }
-        break;
+    byte down = (digitalRead(buttonmap[i]) == LOW);
+    if (down == bitRead(buttonLevels, i)) continue;
+    bitWrite(buttonLevels, i, down);
 
-      case BTNDEBOUNCING:
-        if (currentMillis - buttonEvents[i] > BTNDEBOUNCETIME) {
-          if (digitalRead(buttonmap[i]) == LOW) {
-            buttonStatuses[i] = BTNPRESSED;
-          }
-        }
-        break;
+    byte next = (buttonEdgeHead + 1) & (BTNEDGES - 1);
+    if (next == buttonEdgeTail) {
+      buttonEdgeLost = true;
+      continue;
+    }
+    buttonEdges[buttonEdgeHead].time = buttonClock();
+    buttonEdges[buttonEdgeHead].button = i;
+    buttonEdges[buttonEdgeHead].down = down;
+    buttonEdgeHead = next;
+  }
+}
 
-      case BTNPRESSED:
-        if (digitalRead(buttonmap[i]) == HIGH) {
-          buttonStatuses[i] = BTNRELEASED;
-        } else if (currentMillis - buttonEvents[i] > BTNLONGPRESSTIME) {
-          buttonStatuses[i] = BTNLONGPRESS;
-        }
-        break;
+#ifdef __AVR__
 
-      case BTNRELEASED:
-        break;
+// Both buttons are on port D (pins 3 and 4), PCINT19 and PCINT20
+ISR(PCINT2_vect) {
+  buttonEdge();
+}
 
-      case BTNLONGPRESS:
-        break;
+void setupButtons() {
+  pinMode(MODEBUTTON, INPUT_PULLUP);
+  pinMode(BRIGHTNESSBUTTON, INPUT_PULLUP);
+  PCMSK2 |= _BV(MODEBUTTON) | _BV(BRIGHTNESSBUTTON);
+  PCIFR = _BV(PCIF2);
+  PCICR |= _BV(PCIE2);
+}
 
-      case BTNLONGPRESSREAD:
-        if (digitalRead(buttonmap[i]) == HIGH) {
-          buttonStatuses[i] = BTNIDLE;
-        }
-        break;
+#else
 
-      case BTNGUARDTIME:
-        if (digitalRead(buttonmap[0]) == HIGH && digitalRead(buttonmap[1]) == HIGH) {
-          buttonStatuses[i] = BTNIDLE;
-        }
+// no pin change interrupts on the host, loop() looks for edges instead
+void setupButtons() {
+  pinMode(MODEBUTTON, INPUT_PULLUP);
+  pinMode(BRIGHTNESSBUTTON, INPUT_PULLUP);
+}
+
+#endif
+
+void queueButtonEvent(byte button, byte event) {
+  byte next = (buttonEventHead + 1) & (BTNEVENTS - 1);
+  if (next == buttonEventTail) return; // doButtons() is behind, drop it
+  buttonEventQueue[buttonEventHead] = button << 4 | event;
+  buttonEventHead = next;
+}
+
+void setButtonStatus(byte button, byte status, uint16_t time) {
+  buttonStatuses[button] = status;
+  buttonStateTime[button] = time;
+}
+
+// A debounced press or release at time
+void buttonChanged(byte i, byte down, uint16_t time) {
+  byte other = 1 - i;
+  buttonDown[i] = down;
+
+  if (down) {
+    if (buttonDown[other] && (buttonStatuses[other] == BTNPRESSED || buttonStatuses[other] == BTNSECONDPRESS)) {
+      queueButtonEvent(i, BTNCHORD);
+      setButtonStatus(i, BTNGUARDTIME, time);
+      setButtonStatus(other, BTNGUARDTIME, time);
+    } else if (buttonStatuses[i] == BTNCLICKED) {
+      setButtonStatus(i, BTNSECONDPRESS, time);
+    } else if (buttonStatuses[i] == BTNIDLE) {
+      setButtonStatus(i, BTNPRESSED, time);
     }
+    return;
+  }
+
+  switch (buttonStatuses[i]) {
+    case BTNPRESSED:
+      if (bitRead(BTNDOUBLECLICKS, i)) {
+        setButtonStatus(i, BTNCLICKED, time);
+      } else {
+        queueButtonEvent(i, BTNCLICK);
+        setButtonStatus(i, BTNIDLE, time);
+      }
+      break;
+
+    case BTNSECONDPRESS:
+      queueButtonEvent(i, BTNDOUBLECLICK);
+      setButtonStatus(i, BTNIDLE, time);
+      break;
+
+    case BTNLONGHELD:
+      setButtonStatus(i, BTNIDLE, time);
+      break;
+
+    case BTNGUARDTIME:
+      if (!buttonDown[other]) {
+        setButtonStatus(i, BTNIDLE, time);
+        setButtonStatus(other, BTNIDLE, time);
+      }
+      break;
   }
 }
 
-byte buttonStatus(byte buttonNum) {
+// Long presses and double click timeouts, as of time
+void buttonTimers(byte i, uint16_t time) {
+  uint16_t held = time - buttonStateTime[i];
+  switch (buttonStatuses[i]) {
+    case BTNPRESSED:
+      if (held > BTNLONGPRESSTIME) {
+        queueButtonEvent(i, BTNLONGPRESS);
+        setButtonStatus(i, BTNLONGHELD, time);
+      }
+      break;
+
+    case BTNSECONDPRESS:
+      if (held > BTNLONGPRESSTIME) {
+        queueButtonEvent(i, BTNCLICK);
+        queueButtonEvent(i, BTNLONGPRESS);
+        setButtonStatus(i, BTNLONGHELD, time);
+      }
+      break;
 
-  byte tempStatus = buttonStatuses[buttonNum];
-  if (tempStatus == BTNRELEASED) {
-    buttonStatuses[buttonNum] = BTNIDLE;
-  } else if (tempStatus == BTNLONGPRESS) {
-    buttonStatuses[buttonNum] = BTNLONGPRESSREAD;
+    case BTNCLICKED:
+      if (held > BTNDOUBLECLICKTIME) {
+        queueButtonEvent(i, BTNCLICK);
+        setButtonStatus(i, BTNIDLE, time);
+      }
+      break;
   }
+}
 
-  return tempStatus;
+// Debounce button i up to time: its last level counts once it has held for
+// the debounce time
+void buttonSettle(byte i, uint16_t time) {
+  if (buttonRaw[i] != buttonDown[i] && (uint16_t)(time - buttonRawTime[i]) > BTNDEBOUNCETIME) {
+    buttonTimers(i, buttonRawTime[i]);
+    buttonChanged(i, buttonRaw[i], buttonRawTime[i]);
+  }
+  buttonTimers(i, time);
+}
 
+void updateButtons() {
+#ifndef __AVR__
+  buttonEdge();
+#endif
+
+  // take the queued edges in order, each one settling what came before it,
+  // so a press and its release queued together are still a click
+  while (buttonEdgeTail != buttonEdgeHead) {
+    volatile ButtonEdge &edge = buttonEdges[buttonEdgeTail];
+    byte button = edge.button;
+    uint16_t time = edge.time;
+    for (byte i = 0; i < NUMBUTTONS; i++) buttonSettle(i, time);
+    buttonRaw[button] = edge.down;
+    buttonRawTime[button] = time;
+    buttonEdgeTail = (buttonEdgeTail + 1) & (BTNEDGES - 1);
+  }
+  if (buttonEdgeLost) { // queue overflowed, start again from the pins as they are
+    buttonEdgeLost = false;
+    for (byte i = 0; i < NUMBUTTONS; i++) buttonRaw[i] = bitRead(buttonLevels, i);
+  }
+
+  uint16_t now = buttonClock(); // after the edges, so none of them is later
+  for (byte i = 0; i < NUMBUTTONS; i++) buttonSettle(i, now);
+}
+
+// Next event for doButtons(), BTNNONE when there are none
+byte nextButtonEvent() {
+  if (buttonEventTail == buttonEventHead) return BTNNONE;
+  byte event = buttonEventQueue[buttonEventTail];
+  buttonEventTail = (buttonEventTail + 1) & (BTNEVENTS - 1);
+  return event;
 }
 
 void doButtons() {
+  byte event;
+  while ((event = nextButtonEvent()) != BTNNONE) {
+    byte button = event >> 4;
+    standbyEnd(); // any button wakes the shades up
+    if (button == 0 || (event & 0x0F) == BTNCHORD) showStop(); // taking over from a show
 
-  if ((buttonStatuses[0] == BTNPRESSED) && (buttonStatuses[1] == BTNPRESSED)) {
-    audioEnabled = !audioEnabled; // toggle audio mode
-    switch (audioEnabled) {
-      case true:
-        numEffects = numEffectsAudio;
-        break;
-      case false:
-        numEffects = numEffectsNoAudio;
-        break;
-    }
-    currentEffect = 0;
-    effectInit = false;
-    audioActive = false;
-    eepromMillis = currentMillis;
-    eepromOutdated = true;
-    confirmBlink(CRGB::DarkGreen, 3);
-    buttonStatuses[0] = BTNGUARDTIME;
-    buttonStatuses[1] = BTNGUARDTIME;
-  } else {
-
-    // Check the mode button (for switching between effects)
-    switch (buttonStatus(0)) {
-
-      case BTNRELEASED: // button was pressed and released quickly
-        cycleMillis = currentMillis;
-        if (++currentEffect >= numEffects) currentEffect = 0; // loop to start of effect list
-        effectInit = false; // trigger effect initialization when new effect is selected
+    switch (event & 0x0F) {
+
+      case BTNCHORD: // both buttons pressed together
+        audioEnabled = !audioEnabled; // toggle audio mode
+        switch (audioEnabled) {
+          case true:
+            numEffects = numEffectsAudio;
+            break;
+          case false:
+            numEffects = numEffectsNoAudio;
+            break;
+        }
+        currentEffect = 0;
+        effectInit = false;
         audioActive = false;
         eepromMillis = currentMillis;
         eepromOutdated = true;
+        notify(CRGB::DarkGreen, NOTIFYAUDIO, NOTIFYBLINK, 3);
         break;
 
-      case BTNLONGPRESS: // button was held down for a while
-        autoCycle = !autoCycle; // toggle auto cycle mode
-        // one blue blink: auto mode. two red blinks: manual mode.
-        if (autoCycle) {
-          confirmBlink(CRGB::Blue, 1);
+      case BTNCLICK:
+        if (button == 0) {
+          // mode button: next effect
+          cycleMillis = currentMillis;
+          if (++currentEffect >= numEffects) currentEffect = 0; // loop to start of effect list
+          effectInit = false; // trigger effect initialization when new effect is selected
+          audioActive = false;
         } else {
-          confirmBlink(CRGB::Red, 2);
+          // brightness button: next brightness level
+          FastLED.setBrightness(scale8(nextBrightness(false), MAXBRIGHTNESS));
         }
         eepromMillis = currentMillis;
         eepromOutdated = true;
         break;
 
-    }
-
-    // Check the brightness adjust button
-    switch (buttonStatus(1)) {
-
-      case BTNRELEASED: // button was pressed and released quickly
-        FastLED.setBrightness(scale8(nextBrightness(false), MAXBRIGHTNESS));
+      case BTNDOUBLECLICK: // mode button: back to the previous effect
+        if (button == 1) {
+          // brightness button: play the show from the start
+          showStart();
+          break;
+        }
+        cycleMillis = currentMillis;
+        if (currentEffect-- == 0) currentEffect = numEffects - 1;
+        effectInit = false;
+        audioActive = false;
         eepromMillis = currentMillis;
         eepromOutdated = true;
         break;
 
-      case BTNLONGPRESS: // button was held down for a while
-        // reset brightness to startup value
-        FastLED.setBrightness(scale8(nextBrightness(true), MAXBRIGHTNESS));
+      case BTNLONGPRESS:
+        if (button == 0) {
+          autoCycle = !autoCycle; // toggle auto cycle mode
+          // one blue tick: auto mode. two red crosses: manual mode.
+          if (autoCycle) {
+            notify(CRGB::Blue, NOTIFYAUTO, NOTIFYBLINK, 1);
+          } else {
+            notify(CRGB::Red, NOTIFYMANUAL, NOTIFYBLINK, 2);
+          }
+        } else {
+          // reset brightness to startup value, with a white plus flashed at the new level
+          FastLED.setBrightness(scale8(nextBrightness(true), MAXBRIGHTNESS));
+          notify(CRGB::White, NOTIFYBRIGHTNESS, NOTIFYFLASH, 1);
+        }
         eepromMillis = currentMillis;
         eepromOutdated = true;
         break;
 
     }
-
   }
-
 }
@@ -0,0 +1,89 @@
+// Frame clock
+//
+// millis() counts Timer0 overflows, one every 1.024 ms, in an interrupt.
+// FastLED.show() keeps interrupts off for about 2.1 ms with 68 LEDs, so
+// overflows are lost on most frames and millis() falls behind real time by
+// an amount that depends on the effect's frame rate. Two pairs of shades
+// started together drift apart within minutes.
+//
+// clockMillis() counts Timer1 instead: it runs in CTC mode at 250 kHz and
+// interrupts once every CLOCKPERIOD ms. That is longer than interrupts are
+// ever off, so the compare match is always still pending when they come
+// back on and no time is lost. The milliseconds within a period come from
+// TCNT1. loop(), the effects, the buttons and the power saving all use it
+// through currentMillis and buttonClock().
+//
+// DRIFTTEST: every second, send the values of millis() and clockMillis() to
+// bench/simavr_drift.c through GPIOR2, which compares them with the
+// simulated cycle count.
+
+#define CLOCKPERIOD 16 // ms per Timer1 compare match
+#define CLOCKTICKS 250 // Timer1 counts per ms, 16 MHz / 64
+
+#ifdef __AVR__
+
+volatile unsigned long clockBase = 0; // ms at the last compare match
+
+ISR(TIMER1_COMPA_vect) {
+  clockBase += CLOCKPERIOD;
+}
+
+void setupClock() {
+  TCCR1A = 0;
+  TCCR1B = _BV(WGM12) | _BV(CS11) | _BV(CS10); // CTC on OCR1A, clk/64
+  OCR1A = CLOCKPERIOD * CLOCKTICKS - 1;
+  TCNT1 = 0;
+  TIFR1 = _BV(OCF1A);
+  TIMSK1 = _BV(OCIE1A);
+}
+
+// Safe to call with interrupts off and from other interrupts
+unsigned long clockMillis() {
+  byte sreg = SREG;
+  cli();
+  uint16_t count = TCNT1;
+  unsigned long ms = clockBase;
+  if (TIFR1 & _BV(OCF1A)) { // a match the interrupt hasn't had yet
+    ms += CLOCKPERIOD;
+    count = TCNT1;
+  }
+  SREG = sreg;
+  return ms + count / CLOCKTICKS;
+}
+
+#else
+
+// the host clock doesn't lose time while interrupts are off, like Timer1
+void setupClock() {
+}
+
+unsigned long clockMillis() {
+  return (unsigned long)(hostMicros / 1000);
+}
+
+#endif
+
+#ifdef DRIFTTEST
+
+#define DRIFTMILLIS 1
+#define DRIFTCLOCK 2
+
+unsigned long driftMillis = 0;
+
+// Tag, then the value read right before it, low byte first
+void driftSend(byte tag, unsigned long ms) {
+  GPIOR2 = tag;
+  GPIOR2 = ms;
+  GPIOR2 = ms >> 8;
+  GPIOR2 = ms >> 16;
+  GPIOR2 = ms >> 24;
+}
+
+void driftSample() {
+  if (currentMillis - driftMillis < 1000) return;
+  driftMillis = currentMillis;
+  driftSend(DRIFTMILLIS, millis());
+  driftSend(DRIFTCLOCK, clockMillis());
+}
+
+#endif
@@ -132,6 +132,7 @@ void colorFill() {
     currentRow = 0;
     currentDirection = 0;
     currentPalette = RainbowColors_p;
+    cachePalette();
     fadeActive = 0;
   }
 
@@ -229,7 +230,7 @@ void confetti() {
 
   // scatter random colored pixels at several random coordinates
   for (byte i = 0; i < 4; i++) {
-    leds[XY(random16(kMatrixWidth), random16(kMatrixHeight))] = ColorFromPalette(currentPalette, random16(255), 255); //CHSV(random16(255), 255, 255);
+    leds[XY(random16(kMatrixWidth), random16(kMatrixHeight))] = paletteColor(random16(255)); //CHSV(random16(255), 255, 255);
     random16_add_entropy(1);
   }
 
@@ -280,6 +281,7 @@ void scrollText(byte message, byte style, CRGB fgColor, CRGB bgColor) {
     selectFlashString(message);
     loadCharBuffer(loadStringChar(message, currentMessageChar));
     currentPalette = RainbowColors_p;
+    cachePalette();
     for (byte i = 0; i < kMatrixWidth; i++) bitBuffer[i] = 0;
     fadeActive = 0;
   }
@@ -297,7 +299,7 @@ void scrollText(byte message, byte style, CRGB fgColor, CRGB bgColor) {
     for (byte y = 0; y < 5; y++) { // characters are 5 pixels tall
       if (bitRead(bitBuffer[(bitBufferPointer + x) % kMatrixWidth], y) == 1) {
         if (style == RAINBOW) {
-          pixelColor = ColorFromPalette(currentPalette, paletteCycle+y*16, 255);
+          pixelColor = paletteColor(paletteCycle+y*16);
         } else {
           pixelColor = fgColor;
         }
@@ -341,8 +343,7 @@ void scrollTextTwo() {
 
 
 #define analyzerFadeFactor 5
-#define analyzerScaleFactor 1.5
-#define analyzerPaletteFactor 2
+#define analyzerPaletteFactor 2 // analyzerScaleFactor is in params.h
 void drawAnalyzer() {
   // startup tasks
   if (effectInit == false) {
@@ -355,11 +356,12 @@ void drawAnalyzer() {
 
   CRGB pixelColor;
 
-  const float yScale = 255.0 / kMatrixHeight;
+  const int yScale = 255 / kMatrixHeight;
+  const long scale = PARAMRECIPROCAL(analyzerScaleFactor, 12); // a variable with TUNING, once a frame
 
   for (byte x = 0; x < kMatrixWidth / 2; x++) {
     byte newX = x;
-    int freqVal;
+    long freqVal;
     if (x < 2) {
       newX = 0;
       freqVal = spectrumDecay[newX] / 2;
@@ -370,9 +372,9 @@ void drawAnalyzer() {
     
     for (byte y = 0; y < kMatrixHeight; y++) {
       if (x > 6) {
-        pixelColor = ColorFromPalette(currentPalette, 0, 0);
+        pixelColor = CRGB::Black;
       } else {
-        int senseValue = freqVal / analyzerScaleFactor - yScale * (kMatrixHeight - 1 - y);
+        int senseValue = (freqVal * scale >> 12) - yScale * (kMatrixHeight - 1 - y);
         int pixelBrightness = senseValue * analyzerFadeFactor;
         if (pixelBrightness > 255) pixelBrightness = 255;
         if (pixelBrightness < 0) pixelBrightness = 0;
@@ -381,7 +383,7 @@ void drawAnalyzer() {
         if (pixelPaletteIndex > 240) pixelPaletteIndex = 240;
         if (pixelPaletteIndex < 0) pixelPaletteIndex = 0;
 
-        pixelColor = ColorFromPalette(currentPalette, pixelPaletteIndex, pixelBrightness);
+        pixelColor = paletteColor(pixelPaletteIndex, pixelBrightness);
       }
       leds[XY(x, y)] = pixelColor;
       leds[XY(kMatrixWidth - x - 1, y)] = pixelColor;
@@ -391,9 +393,7 @@ void drawAnalyzer() {
 
 }
 
-#define VUFadeFactor 5
-#define VUScaleFactor 2.0
-#define VUPaletteFactor 1.5
+#define VUFadeFactor 5 // VUScaleFactor is in params.h
 void drawVU() {
   // startup tasks
   if (effectInit == false) {
@@ -406,20 +406,22 @@ void drawVU() {
 
   CRGB pixelColor;
 
-  const float xScale = 255.0 / (kMatrixWidth / 2);
-  float specCombo = (spectrumDecay[0] + spectrumDecay[1] + spectrumDecay[2] + spectrumDecay[3]) / 4.0;
+  // in 1/256ths: the mean of the four lowest bands over VUScaleFactor, and 255 / 8 a column
+  const long xScale = 255L * 256 / (kMatrixWidth / 2);
+  long specCombo = ((long)spectrumDecay[0] + spectrumDecay[1] + spectrumDecay[2] + spectrumDecay[3]) *
+                   PARAMRECIPROCAL(VUScaleFactor, 10) >> 4;
 
   for (byte x = 0; x < kMatrixWidth / 2; x++) {
-    int senseValue = specCombo / VUScaleFactor - xScale * x;
+    int senseValue = (specCombo - xScale * x) / 256;
     int pixelBrightness = senseValue * VUFadeFactor;
     if (pixelBrightness > 255) pixelBrightness = 255;
     if (pixelBrightness < 0) pixelBrightness = 0;
 
-    int pixelPaletteIndex = senseValue / VUPaletteFactor - 15;
+    int pixelPaletteIndex = senseValue * 2 / 3 - 15;
     if (pixelPaletteIndex > 240) pixelPaletteIndex = 240;
     if (pixelPaletteIndex < 0) pixelPaletteIndex = 0;
 
-    pixelColor = ColorFromPalette(currentPalette, pixelPaletteIndex, pixelBrightness);
+    pixelColor = paletteColor(pixelPaletteIndex, pixelBrightness);
 
     for (byte y = 0; y < kMatrixHeight; y++) {
       leds[XY(x, y)] = pixelColor;
@@ -489,8 +491,10 @@ void audioPlasma() {
   // Draw one frame of the animation into the LED array
   for (int x = 0; x < kMatrixWidth; x++) {
     for (int y = 0; y < kMatrixHeight; y++) {
-      byte color = sin8(sqrt(sq(((float)x - 7.5) * 12 + xOffset) + sq(((float)y - 2) * 12 + yOffset)) + offset);
-      leds[XY(x, y)] = ColorFromPalette(currentPalette, color, 255);
+      int dx = (2 * x - 15) * 6 + xOffset; // (x - 7.5) * 12
+      int dy = (y - 2) * 12 + yOffset;
+      byte color = sin8(sqrt16(dx * dx + dy * dy) + offset);
+      leds[XY(x, y)] = paletteColor(color);
     }
   }
 
@@ -564,7 +568,7 @@ void audioSpin() {
       //byte color = sin8(sqrt(sq(((float)x - 7.5) * 12 + xOffset) + sq(((float)y - 2) * 12 + yOffset)) + offset);
       float tanxy = ((float)(x-7.5)/(float)((y-2))*2);
       byte color = sin8(tanxy*10+plasVector/100);
-      leds[XY(x, y)] = ColorFromPalette(currentPalette, color, 255);
+      leds[XY(x, y)] = paletteColor(color);
     }
   }
 
@@ -591,17 +595,20 @@ void audioStripes() {
   for (byte y = 0; y < 5; y++) {
 
     //audioLevel = spectrumDecay[y+1] / 2.0;
-    audioLevel = spectrumPeaks[y+1] / 1.8;
+    audioLevel = spectrumPeaks[y+1];
+    if (audioLevel > 1000) audioLevel = 1000; // it ends up 239 anyway, and * 5 fits an int
+    audioLevel = audioLevel * 5 / 9; // / 1.8
     if (y == 0) audioLevel /= 2;
     if (audioLevel > 239) audioLevel = 239;
 
-
+    // one colour for the row, only the brightness changes along it
+    CRGB rowcolor = paletteColor(audioLevel);
     
     for (byte x = 0; x < kMatrixWidth; x++) {
-          brightLevel = (audioLevel-(abs(7.5-x)*20)) * 3.0;
+          brightLevel = (audioLevel - abs(15 - 2 * x) * 10) * 3; // 20 a column from the middle
           if (brightLevel < 0) brightLevel = 0;
           if (brightLevel > 254) brightLevel = 254;
-          linecolor = ColorFromPalette(currentPalette, audioLevel, brightLevel);
+          linecolor = paletteScale(rowcolor, brightLevel);
       leds[XY(x, 4-y)] = linecolor;
     }
   }
@@ -619,20 +626,21 @@ void shadesOutline() {
     effectDelay = 25;
     FastLED.clear();
     currentPalette = RainbowColors_p;
+    cachePalette();
     fadeActive = 2;
   }
 
   CRGB pixelColor = CHSV(cycleHue, 255, 255);
-  leds[OutlineMap(x)] = pixelColor;
+  leds[pathLed(PATHOUTLINE, x)] = pixelColor;
 
   x++;
-  if (x > (OUTLINESIZE-1)) x = 0;
+  if (x >= pathLength(PATHOUTLINE)) x = 0;
   
 }
 
 void audioShadesOutline() {
   
-  static float x = 0;
+  static uint16_t x = 0; // 8.8 along the outline
   
   //startup tasks
   if (effectInit == false) {
@@ -640,24 +648,27 @@ void audioShadesOutline() {
     effectDelay = 15;
     FastLED.clear();
     currentPalette = RainbowColors_p;
+    cachePalette();
     fadeActive = 10;
     audioActive = true;
   }
 
   static uint8_t beatcount = 0;
 
-  int brightness = (spectrumDecay[0] + spectrumDecay[1]);
-  if (brightness > 255) brightness = 255;
+  long bass = (long)spectrumDecay[0] + spectrumDecay[1];
+  byte brightness = constrain(bass, 0, 255);
 
   CRGB pixelColor = CHSV(cycleHue, 255, brightness);
   
+  // four dots a quarter of the way round from each other, between LEDs
+  uint16_t dot = x;
   for (byte k = 0; k < 4; k++) {
-    leds[OutlineMap(x+(OUTLINESIZE/4-1)*k)] += pixelColor;
+    drawComet(PATHOUTLINE, dot, 1, pixelColor, true);
+    dot = pathMove(PATHOUTLINE, dot, (pathLength(PATHOUTLINE) / 4) << 8);
   }
 
-  float xincr = (spectrumDecay[0] + spectrumDecay[1]) / 600.0;
-  if (xincr > 1.0) xincr = 1.0;
-  if (xincr < 0.1) xincr = 0.1;
+  // a pixel a frame at 600, no less than a tenth
+  int16_t xincr = constrain(bass, 60, 600) * 256 / 600;
 
 
 
@@ -668,61 +679,18 @@ void audioShadesOutline() {
   }
 
   if (beatcount < 16 ) {
-    x += xincr;
+    x = pathMove(PATHOUTLINE, x, xincr);
   } else {
-    x -= xincr;
+    x = pathMove(PATHOUTLINE, x, -xincr);
   }
   
-  if (x > (OUTLINESIZE-1)) x = 0;
-  if (x < 0) x = OUTLINESIZE - 1;
-  
 }
 
 
 //hearts that start small on the bottom and get larger as they grow upward
-const uint8_t SmHeart[] = {46, 48, 53, 55, 60, 65};
-const uint8_t MedHeart[] = {31, 32, 34, 35, 38, 39,
-                            41, 42, 46, 47, 48, 55, 54, 53, 54, 55, 60, 65
-                           };
-const uint8_t LrgHeart[] = {15, 16, 18, 19, 24, 25,
-                            27, 28, 31, 32, 33, 34, 35, 38, 39, 40, 41, 42,
-                            46, 47, 48, 53, 54, 55, 60, 65
-                           };
-const uint8_t HugeHeart[] = {0, 1, 3, 4, 9, 10, 12,
-                             13, 14, 15, 16, 17, 18, 19, 20, 23, 24, 25, 26,
-                             27, 28, 29, 31, 32, 33, 34, 35, 38, 39, 40, 41,
-                             42, 46, 47, 48, 53, 54, 55, 60, 65
-                            };
+//baked into baked.h from the original, which drew them from four lists of LEDs
 void hearts() {
-  static boolean erase = false;
-  static uint8_t x, y = 0;
-  if (effectInit == false) {
-    effectInit = true;
-    effectDelay = 150;
-    FastLED.clear();
-    fadeActive = 0;
-
-    x = 0;
-    y = 0;
-  }
-  if (y == 5)
-    y = 0;
-  if (y == 0)
-    for (x = 0; x < 6; x++)
-      leds[SmHeart[x]] = CRGB::Salmon; //Tried to transition from pink-ish to red. Kinda worked.
-  if (y == 1)
-    for (x = 0; x < 18; x++)
-      leds[MedHeart[x]] = CRGB::Tomato;
-  if (y == 2)
-    for (x = 0; x < 26; x++)
-      leds[LrgHeart[x]] = CRGB::Crimson;
-  if (y == 3) {
-    for (x = 0; x < 40; x++)
-      leds[HugeHeart[x]] = CRGB::Red;
-  } //set the delay slightly longer for HUGE heart.
-  if (y == 4)
-    FastLED.clear();
-  y++;
+  playAnimation(&heartsAnimation);
 }
 
 
@@ -825,17 +793,18 @@ void noiseFlyer() {
   static byte heading = 0;
 
   fillnoise8();
-  float kph = (spectrumDecay[0] + spectrumDecay[1] + spectrumDecay[2]) / 3.0;
+  long kph = (long)spectrumDecay[0] + spectrumDecay[1] + spectrumDecay[2]; // 3 times the mean
+  int kphBrightness = kph / 12 - 72;
   
   int brightness;
 
   for (byte x = 0; x < kMatrixWidth; x++) {
     for (byte y = 0; y < kMatrixHeight; y++) {
-      brightness = kph/4 - 72;
+      brightness = kphBrightness;
       brightness += noise[x][y];
       if (brightness > 240) brightness = 240;
       if (brightness < 0) brightness = 0;
-      CRGB pixelColor = ColorFromPalette(currentPalette, brightness, 255);
+      CRGB pixelColor = paletteColor(brightness);
       leds[XY(x,y)] = pixelColor;
     }
   }
@@ -846,11 +815,34 @@ void noiseFlyer() {
 
 
   
-  nx += sin8(heading) * kph / 6000 + 5;
-  ny += cos8(heading) * kph / 6000 + 5;
+  nx += sin8(heading) * kph / 18000 + 5;
+  ny += cos8(heading) * kph / 18000 + 5;
 
   
 }
 
 
+// Diagnostic: free RAM now on the top three rows, lowest free RAM since
+// power up on the bottom two, one column for every 64 bytes
+#define RAMMETERSCALE 64
+void ramMeter() {
+  // startup tasks
+  if (effectInit == false) {
+    effectInit = true;
+    effectDelay = 100;
+    fadeActive = 0;
+  }
+
+  byte freeColumns = freeRam() / RAMMETERSCALE;
+  byte minColumns = minFreeRam() / RAMMETERSCALE;
 
+  for (byte x = 0; x < kMatrixWidth; x++) {
+    for (byte y = 0; y < kMatrixHeight; y++) {
+      if (y < 3) {
+        leds[XY(x, y)] = (x < freeColumns) ? CRGB::Green : CRGB::Black;
+      } else {
+        leds[XY(x, y)] = (x < minColumns) ? CRGB::Orange : CRGB::Red;
+      }
+    }
+  }
+}
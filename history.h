@@ -0,0 +1,120 @@
+// Spectrum history
+//
+// The last HISTORYLENGTH samples of all 7 bands, one every HISTORYDELAY ms,
+// so about a second of audio. A sample is the loudest spectrumValue read
+// since the one before, divided by 4 to fit a byte. Running sums and sums of
+// squares are kept per band as samples come and go, so the mean, variance
+// and RMS over the whole window cost a few instructions each.
+//
+// 224 bytes of samples, 42 of sums, 12 more besides. Only linked in when an
+// effect that reads the history is: it starts recording by setting
+// historyRecorder, which loop() calls after every doAnalogs().
+
+#define HISTORYLENGTH 32 // samples, a power of 2
+#define HISTORYSHIFT 5   // log2(HISTORYLENGTH)
+#define HISTORYDELAY 32  // ms between samples
+
+byte spectrumHistory[HISTORYLENGTH][7];
+byte historyHead = 0;              // where the next sample goes
+byte historyLoudest[7];            // since the last sample
+uint16_t historySum[7];
+uint32_t historySquares[7];
+unsigned long historyMillis = 0;
+void (*historyRecorder)() = 0;     // recordHistory() once an effect wants the history
+
+// Add a sample, dropping the oldest from the sums
+void historyPush(const byte *sample) {
+  byte *slot = spectrumHistory[historyHead];
+  for (byte i = 0; i < 7; i++) {
+    historySum[i] += sample[i] - slot[i];
+    historySquares[i] += (uint16_t)sample[i] * sample[i];
+    historySquares[i] -= (uint16_t)slot[i] * slot[i];
+    slot[i] = sample[i];
+  }
+  historyHead = (historyHead + 1) & (HISTORYLENGTH - 1);
+}
+
+// Called after every doAnalogs()
+void recordHistory() {
+  for (byte i = 0; i < 7; i++) {
+    byte level = spectrumValue[i] > 1020 ? 255 : spectrumValue[i] / 4;
+    if (level > historyLoudest[i]) historyLoudest[i] = level;
+  }
+  if (currentMillis - historyMillis < HISTORYDELAY) return;
+  historyMillis = currentMillis;
+  historyPush(historyLoudest);
+  memset(historyLoudest, 0, sizeof(historyLoudest));
+}
+
+// A band age samples ago, 0 = the newest
+inline byte historyValue(byte band, byte age) {
+  return spectrumHistory[(historyHead - 1 - age) & (HISTORYLENGTH - 1)][band];
+}
+
+inline byte historyMean(byte band) {
+  return historySum[band] >> HISTORYSHIFT;
+}
+
+// Mean square less the square of the mean, 0 to 16256
+inline uint16_t historyVariance(byte band) {
+  uint16_t mean = historySum[band] >> HISTORYSHIFT;
+  return (historySquares[band] >> HISTORYSHIFT) - mean * mean;
+}
+
+inline byte historyRMS(byte band) {
+  return sqrt16(historySquares[band] >> HISTORYSHIFT);
+}
+
+
+#ifdef BENCHMARK
+// Time adding a sample as BENCH_HISTORY + 0, and reading the mean, variance
+// and RMS of all 7 bands as BENCH_HISTORY + 1
+volatile uint16_t historyBenchSink;
+void historyBench() {
+  byte sample[7];
+  for (byte step = 0; step < 2; step++) {
+    GPIOR1 = BENCH_HISTORY | step;
+    for (uint16_t i = 0; i < BENCH_FRAMES; i++) {
+      for (byte band = 0; band < 7; band++) sample[band] = random8();
+      STAGE_BEGIN(STAGE_EFFECT);
+      if (step == 0) {
+        historyPush(sample);
+      } else {
+        for (byte band = 0; band < 7; band++) {
+          historyBenchSink = historyMean(band) + historyVariance(band) + historyRMS(band);
+        }
+      }
+      STAGE_END(STAGE_EFFECT);
+    }
+  }
+}
+#endif
+
+
+// History effects
+
+// Spectrogram: the newest sample on the left, scrolling right, bass at the
+// bottom and treble at the top. Bands 2 and 5 are left out to fit 5 rows.
+void waterfall() {
+
+  // startup tasks
+  if (effectInit == false) {
+    effectInit = true;
+    effectDelay = 10;
+    selectRandomAudioPalette();
+    audioActive = true;
+    fadeActive = 0;
+    historyRecorder = recordHistory;
+  }
+
+  for (byte y = 0; y < kMatrixHeight; y++) {
+    byte band = (kMatrixHeight - 1 - y) * 3 / 2;
+    byte floor = historyMean(band) / 2; // so a steady level stays dim
+    for (byte x = 0; x < kMatrixWidth; x++) {
+      byte level = historyValue(band, x);
+      byte bright = qsub8(level, floor);
+      leds[XY(x, y)] = paletteColor(level, qadd8(bright, bright));
+    }
+  }
+
+}
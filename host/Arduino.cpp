@@ -0,0 +1,355 @@
+// Host implementation of the Arduino core and the RGB Shades board model
+
+#include "Arduino.h"
+#include "EEPROM.h"
+#include "FastLED.h"
+
+#include <deque>
+#include <stdio.h>
+
+// RGB Shades wiring of the MSGEQ7 (matches audio.h)
+#define BOARD_ANALOGPIN 3
+#define BOARD_STROBEPIN 8
+#define BOARD_RESETPIN 7
+
+// Approximate cost of one analogRead() at the default ADC prescaler
+#define ANALOGREAD_US 112
+
+#define NUM_PINS 20
+
+uint64_t hostMicros = 0;
+
+static uint8_t pinLevels[NUM_PINS];
+static uint8_t pinModes[NUM_PINS];
+static uint8_t pinsInitialized = 0;
+
+static HostSpectrumSource spectrumSource = hostSyntheticSpectrum;
+static int8_t msgeq7Band = -1;
+
+static void initPins() {
+  if (pinsInitialized) return;
+  pinsInitialized = 1;
+  for (uint8_t i = 0; i < NUM_PINS; i++) {
+    pinLevels[i] = HIGH; // inputs float high, buttons are active low
+    pinModes[i] = INPUT;
+  }
+}
+
+void hostAdvance(uint32_t us) {
+  hostMicros += us;
+}
+
+void hostSetPin(uint8_t pin, uint8_t level) {
+  initPins();
+  if (pin < NUM_PINS) pinLevels[pin] = level;
+}
+
+void hostSetSpectrumSource(HostSpectrumSource source) {
+  spectrumSource = source ? source : hostSyntheticSpectrum;
+}
+
+// Default audio: a 120 BPM kick in the bass bands and slow swells above it
+uint16_t hostSyntheticSpectrum(uint8_t band, uint64_t micros) {
+  uint32_t ms = micros / 1000;
+  uint16_t beatPhase = ms % 500;
+  if (band < 2) {
+    if (beatPhase < 150) return 950 - beatPhase * 4;
+    return 250;
+  }
+  uint8_t swell = sin8((ms / 20) + band * 40);
+  return 150 + swell * 2 + (beatPhase < 60 ? 120 : 0);
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  initPins();
+  if (pin < NUM_PINS) pinModes[pin] = mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  initPins();
+  if (pin >= NUM_PINS) return;
+
+  // MSGEQ7: reset returns to the first band, each strobe falling edge
+  // presents the next band on the output
+  if (pin == BOARD_RESETPIN && val == HIGH) {
+    msgeq7Band = -1;
+  } else if (pin == BOARD_STROBEPIN && val == LOW && pinLevels[pin] == HIGH) {
+    if (++msgeq7Band > 6) msgeq7Band = 0;
+  }
+
+  pinLevels[pin] = val;
+}
+
+int digitalRead(uint8_t pin) {
+  initPins();
+  if (pin >= NUM_PINS) return LOW;
+  return pinLevels[pin];
+}
+
+int analogRead(uint8_t pin) {
+  hostAdvance(ANALOGREAD_US);
+  if (pin == BOARD_ANALOGPIN && msgeq7Band >= 0) {
+    uint16_t value = spectrumSource(msgeq7Band, hostMicros);
+    return value > 1023 ? 1023 : value;
+  }
+  return 0;
+}
+
+void analogReference(uint8_t mode) {
+}
+
+// millis() and micros() count Timer0 overflows, one every 1024 us. While
+// interrupts are off only one overflow can be pending, later ones are lost.
+#define TIMER0_OVERFLOW_US 1024
+uint64_t hostTimer0Lost = 0;
+
+unsigned long millis() {
+  return (unsigned long)((hostMicros - hostTimer0Lost) / 1000);
+}
+
+unsigned long micros() {
+  return (unsigned long)(hostMicros - hostTimer0Lost);
+}
+
+void delay(unsigned long ms) {
+  hostMicros += (uint64_t)ms * 1000;
+}
+
+void delayMicroseconds(unsigned int us) {
+  hostMicros += us;
+}
+
+
+// Serial
+
+HardwareSerial Serial;
+
+#define SERIAL_RX_SIZE 64
+#define SERIAL_TX_SIZE 64
+#define UART_RX_FIFO 2 // bytes the UART holds for the receive interrupt
+
+static FILE *serialOutput = 0;
+static uint8_t serialRx[SERIAL_RX_SIZE];
+static size_t serialRxHead = 0;
+static size_t serialRxTail = 0;
+uint32_t hostSerialLost = 0;
+
+// bytes on their way in from the host, the first one arrives at serialWireMicros
+static std::deque<uint8_t> serialWire;
+static uint64_t serialWireMicros = 0;
+
+// transmit buffer level and when it was last updated, drained at the baud rate
+static uint32_t serialTxLevel = 0;
+static uint64_t serialTxMicros = 0;
+
+static void drainTx() {
+  if (!Serial.baud) {
+    serialTxLevel = 0;
+    return;
+  }
+  uint64_t byteMicros = 10000000ULL / Serial.baud;
+  uint64_t sent = (hostMicros - serialTxMicros) / byteMicros;
+  if (sent >= serialTxLevel) {
+    serialTxLevel = 0;
+    serialTxMicros = hostMicros;
+  } else {
+    serialTxLevel -= sent;
+    serialTxMicros += sent * byteMicros;
+  }
+}
+
+// receive interrupt: into the ring buffer, dropped when it is full like on the AVR
+static void receiveByte(uint8_t c) {
+  size_t next = (serialRxHead + 1) % SERIAL_RX_SIZE;
+  if (next == serialRxTail) {
+    hostSerialLost++;
+    return;
+  }
+  serialRx[serialRxHead] = c;
+  serialRxHead = next;
+}
+
+// take in everything that has arrived by until, with interrupts on
+static void receiveRx(uint64_t until) {
+  while (!serialWire.empty() && serialWireMicros <= until) {
+    receiveByte(serialWire.front());
+    serialWire.pop_front();
+    serialWireMicros += 10000000ULL / Serial.baud;
+  }
+}
+
+void hostInterruptsOff(uint32_t us) {
+  receiveRx(hostMicros);
+  uint64_t overflows = (hostMicros + us) / TIMER0_OVERFLOW_US - hostMicros / TIMER0_OVERFLOW_US;
+  if (overflows > 1) hostTimer0Lost += (overflows - 1) * TIMER0_OVERFLOW_US;
+  hostMicros += us;
+
+  // the UART keeps UART_RX_FIFO bytes, later ones overrun
+  uint8_t held[UART_RX_FIFO];
+  int count = 0;
+  while (!serialWire.empty() && serialWireMicros <= hostMicros) {
+    if (count < UART_RX_FIFO) {
+      held[count++] = serialWire.front();
+    } else {
+      hostSerialLost++;
+    }
+    serialWire.pop_front();
+    serialWireMicros += 10000000ULL / Serial.baud;
+  }
+  for (int i = 0; i < count; i++) receiveByte(held[i]);
+}
+
+void hostSetSerialOutput(FILE *file) {
+  serialOutput = file;
+}
+
+uint64_t hostSerialInput(const uint8_t *data, size_t length) {
+  if (!Serial.baud) {
+    hostSerialLost += length; // nobody listening yet
+    return hostMicros;
+  }
+  uint64_t byteMicros = 10000000ULL / Serial.baud;
+  receiveRx(hostMicros);
+  if (serialWire.empty()) serialWireMicros = hostMicros + byteMicros;
+  serialWire.insert(serialWire.end(), data, data + length);
+  return serialWireMicros + (serialWire.size() - 1) * byteMicros;
+}
+
+HardwareSerial::HardwareSerial() : baud(0) {
+}
+
+void HardwareSerial::begin(unsigned long b) {
+  baud = b;
+  serialTxLevel = 0;
+  serialTxMicros = hostMicros;
+}
+
+int HardwareSerial::available() {
+  receiveRx(hostMicros);
+  return (serialRxHead + SERIAL_RX_SIZE - serialRxTail) % SERIAL_RX_SIZE;
+}
+
+int HardwareSerial::read() {
+  receiveRx(hostMicros);
+  if (serialRxHead == serialRxTail) return -1;
+  uint8_t c = serialRx[serialRxTail];
+  serialRxTail = (serialRxTail + 1) % SERIAL_RX_SIZE;
+  return c;
+}
+
+int HardwareSerial::peek() {
+  receiveRx(hostMicros);
+  if (serialRxHead == serialRxTail) return -1;
+  return serialRx[serialRxTail];
+}
+
+int HardwareSerial::availableForWrite() {
+  drainTx();
+  return SERIAL_TX_SIZE - 1 - serialTxLevel;
+}
+
+// like the AVR, writing to a full transmit buffer waits for a byte to go out
+size_t HardwareSerial::write(uint8_t c) {
+  drainTx();
+  if (baud && serialTxLevel >= SERIAL_TX_SIZE - 1) {
+    hostMicros = serialTxMicros + 10000000ULL / baud;
+    drainTx();
+  }
+  if (baud) {
+    if (serialTxLevel == 0) serialTxMicros = hostMicros;
+    serialTxLevel++;
+  }
+  if (serialOutput) fputc(c, serialOutput);
+  return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+  for (size_t i = 0; i < size; i++) write(buffer[i]);
+  return size;
+}
+
+size_t HardwareSerial::print(const char *s) {
+  return write((const uint8_t *)s, strlen(s));
+}
+
+size_t HardwareSerial::print(char c) {
+  return write((uint8_t)c);
+}
+
+size_t HardwareSerial::print(unsigned long n, int base) {
+  char buf[8 * sizeof(long) + 1];
+  char *str = &buf[sizeof(buf) - 1];
+  *str = 0;
+  if (base < 2) base = 10;
+  do {
+    char c = n % base;
+    n /= base;
+    *--str = c < 10 ? c + '0' : c + 'A' - 10;
+  } while (n);
+  return print(str);
+}
+
+size_t HardwareSerial::print(long n, int base) {
+  if (n < 0 && base == DEC) return print('-') + print((unsigned long)-n, base);
+  return print((unsigned long)n, base);
+}
+
+size_t HardwareSerial::println() {
+  return print("\r\n");
+}
+
+
+// EEPROM
+
+EEPROMClass EEPROM;
+
+EEPROMClass::EEPROMClass() : writeCount(0), busyUntil(0) {
+  memset(data, 0xFF, sizeof(data));
+}
+
+// like eeprom_read_byte(), reading waits for a write in progress
+uint8_t EEPROMClass::read(int address) {
+  if (!ready()) hostMicros = busyUntil;
+  if (address < 0 || address >= EEPROM_SIZE) return 0xFF;
+  return data[address];
+}
+
+void EEPROMClass::write(int address, uint8_t value) {
+  if (address < 0 || address >= EEPROM_SIZE) return;
+  if (!ready()) hostMicros = busyUntil;
+  hostAdvance(EEPROM_WRITE_US);
+  data[address] = value;
+  writeCount++;
+}
+
+bool EEPROMClass::ready() {
+  return hostMicros >= busyUntil;
+}
+
+void EEPROMClass::writeBackground(int address, uint8_t value) {
+  if (address < 0 || address >= EEPROM_SIZE) return;
+  if (!ready()) hostMicros = busyUntil;
+  busyUntil = hostMicros + EEPROM_WRITE_US;
+  data[address] = value;
+  writeCount++;
+}
+
+void EEPROMClass::update(int address, uint8_t value) {
+  if (read(address) != value) write(address, value);
+}
+
+bool EEPROMClass::load(const char *path) {
+  FILE *f = fopen(path, "rb");
+  if (!f) return false;
+  size_t n = fread(data, 1, sizeof(data), f);
+  fclose(f);
+  return n == sizeof(data);
+}
+
+bool EEPROMClass::save(const char *path) {
+  FILE *f = fopen(path, "wb");
+  if (!f) return false;
+  size_t n = fwrite(data, 1, sizeof(data), f);
+  fclose(f);
+  return n == sizeof(data);
+}
@@ -0,0 +1,125 @@
+// Minimal Arduino core for building the RGB Shades sketch on a workstation
+//
+// Only the parts of the Arduino API used by the sketch are provided.
+// Time is virtual: millis()/micros() read a clock that only moves when the
+// sketch does something that takes time on the real hardware (delays, ADC
+// conversions, LED output, EEPROM writes), so setup()/loop() run headless
+// as fast as the host allows.
+//
+// The board model at the bottom of this file stands in for the RGB Shades
+// hardware: two buttons with pullups and an MSGEQ7 on the strobe/reset pins.
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+#include <cmath>
+#include <cstdlib>
+
+#include "avr/pgmspace.h"
+
+using std::abs;
+
+typedef uint8_t byte;
+typedef bool boolean;
+typedef uint16_t word;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define DEFAULT 1
+
+#define sq(x) ((x)*(x))
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define bitWrite(value, bit, bitvalue) ((bitvalue) ? bitSet(value, bit) : bitClear(value, bit))
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void analogReference(uint8_t mode);
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+
+#define DEC 10
+#define HEX 16
+
+// Serial port: output goes to a host file (if any), input is queued by the host
+class HardwareSerial {
+  public:
+    HardwareSerial();
+    void begin(unsigned long baud);
+    void end() {}
+    int available();
+    int read();
+    int peek();
+    int availableForWrite();
+    void flush() {}
+
+    size_t write(uint8_t c);
+    size_t write(const uint8_t *buffer, size_t size);
+    size_t print(const char *s);
+    size_t print(char c);
+    size_t print(unsigned long n, int base = DEC);
+    size_t print(long n, int base = DEC);
+    size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+    size_t print(int n, int base = DEC) { return print((long)n, base); }
+    size_t print(unsigned char n, int base = DEC) { return print((unsigned long)n, base); }
+    size_t println();
+    template <class T> size_t println(T value) { return print(value) + println(); }
+    template <class T> size_t println(T value, int base) { return print(value, base) + println(); }
+    operator bool() { return true; }
+
+    // host side
+    unsigned long baud;
+};
+
+extern HardwareSerial Serial;
+
+
+// Host board model (not part of the Arduino API)
+
+// Virtual clock in microseconds since power up
+extern uint64_t hostMicros;
+void hostAdvance(uint32_t us);
+
+// Drive an input pin from the host, e.g. hostSetPin(MODEBUTTON, LOW) to press SW1
+void hostSetPin(uint8_t pin, uint8_t level);
+
+// Supplies the MSGEQ7 output (0-1023) for a band at a point in virtual time
+typedef uint16_t (*HostSpectrumSource)(uint8_t band, uint64_t micros);
+void hostSetSpectrumSource(HostSpectrumSource source);
+uint16_t hostSyntheticSpectrum(uint8_t band, uint64_t micros);
+
+// Serial output is written to this file when set
+void hostSetSerialOutput(FILE *file);
+
+// Send bytes to the sketch. They arrive one after another at the baud rate,
+// after anything sent earlier; returns when the last one will have arrived.
+// Bytes the sketch never gets (receive buffer full, overruns while interrupts
+// are off, nothing listening yet) are counted in hostSerialLost.
+uint64_t hostSerialInput(const uint8_t *data, size_t length);
+extern uint32_t hostSerialLost;
+
+// Advance the clock with interrupts blocked, as FastLED.show() does
+void hostInterruptsOff(uint32_t us);
+
+// Time millis() and micros() have lost to Timer0 overflows while interrupts were off
+extern uint64_t hostTimer0Lost;
+
+#endif
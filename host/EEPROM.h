@@ -0,0 +1,37 @@
+// EEPROM for the host build: 1 KB like the ATmega328, erased to 0xFF
+//
+// Writes cost 3.3 ms of virtual time, matching the blocking write on the AVR.
+// writeBackground() stands in for a write started from the EEPROM ready
+// interrupt: it returns at once, and the EEPROM is busy for the next 3.3 ms.
+
+#ifndef HOST_EEPROM_H
+#define HOST_EEPROM_H
+
+#include <stdint.h>
+
+#define EEPROM_SIZE 1024
+#define EEPROM_WRITE_US 3300
+
+class EEPROMClass {
+  public:
+    EEPROMClass();
+    uint8_t read(int address);
+    void write(int address, uint8_t value);
+    void update(int address, uint8_t value);
+    uint16_t length() { return EEPROM_SIZE; }
+
+    // host side: the EEPROM ready interrupt
+    bool ready();
+    void writeBackground(int address, uint8_t value);
+
+    // host side: load/save the contents so settings survive between runs
+    bool load(const char *path);
+    bool save(const char *path);
+    uint32_t writeCount;
+    uint8_t data[EEPROM_SIZE];
+    uint64_t busyUntil;
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
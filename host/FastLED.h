@@ -0,0 +1,338 @@
+// Minimal FastLED for building the RGB Shades sketch on a workstation
+//
+// Follows FastLED 3.x semantics for the parts the sketch uses: CRGB/CHSV,
+// rainbow HSV conversion, 16-entry palettes with linear blending, the 8-bit
+// math helpers, sin8/sin16, inoise8 and the random8/random16 generator.
+// show() hands the frame to a host hook and advances the virtual clock by
+// the time the WS2811 data would take to clock out.
+
+#ifndef HOST_FASTLED_H
+#define HOST_FASTLED_H
+
+#include "Arduino.h"
+
+typedef uint8_t fract8;
+typedef uint16_t accum88;
+
+// 8-bit math
+
+inline uint8_t scale8(uint8_t i, uint8_t scale) {
+  return ((uint16_t)i * (1 + (uint16_t)scale)) >> 8;
+}
+
+inline uint8_t scale8_video(uint8_t i, uint8_t scale) {
+  return (((uint16_t)i * (uint16_t)scale) >> 8) + ((i && scale) ? 1 : 0);
+}
+
+inline uint8_t qadd8(uint8_t i, uint8_t j) {
+  unsigned int t = i + j;
+  return t > 255 ? 255 : t;
+}
+
+inline uint8_t qsub8(uint8_t i, uint8_t j) {
+  int t = i - j;
+  return t < 0 ? 0 : t;
+}
+
+// a blended towards b by amountOfB
+inline uint8_t blend8(uint8_t a, uint8_t b, uint8_t amountOfB) {
+  uint16_t partial = (a << 8) | b;
+  partial += b * amountOfB;
+  partial -= a * amountOfB;
+  return partial >> 8;
+}
+
+inline uint8_t qmul8(uint8_t i, uint8_t j) {
+  unsigned int p = (unsigned)i * (unsigned)j;
+  return p > 255 ? 255 : p;
+}
+
+// floor of the square root, like FastLED's
+inline uint8_t sqrt16(uint16_t x) {
+  uint8_t root = 0;
+  for (uint8_t bit = 0x80; bit; bit >>= 1) {
+    uint8_t trial = root | bit;
+    if ((uint16_t)trial * trial <= x) root = trial;
+  }
+  return root;
+}
+
+inline uint8_t triwave8(uint8_t in) {
+  if (in & 0x80) in = 255 - in;
+  return in << 1;
+}
+
+inline uint8_t ease8InOutQuad(uint8_t i) {
+  uint8_t j = i;
+  if (j & 0x80) j = 255 - j;
+  uint8_t jj = scale8(j, j);
+  uint8_t jj2 = jj << 1;
+  if (i & 0x80) jj2 = 255 - jj2;
+  return jj2;
+}
+
+uint8_t sin8(uint8_t theta);
+inline uint8_t cos8(uint8_t theta) { return sin8(theta + 64); }
+int16_t sin16(uint16_t theta);
+inline int16_t cos16(uint16_t theta) { return sin16(theta + 16384); }
+
+uint8_t inoise8(uint16_t x, uint16_t y, uint16_t z);
+uint8_t inoise8(uint16_t x, uint16_t y);
+
+// pseudo-random numbers, same LCG as FastLED
+
+extern uint16_t rand16seed;
+
+inline uint8_t random8() {
+  rand16seed = (rand16seed * 2053) + 13849;
+  return (uint8_t)(((uint8_t)(rand16seed & 0xFF)) + ((uint8_t)(rand16seed >> 8)));
+}
+
+inline uint8_t random8(uint8_t lim) {
+  return (random8() * lim) >> 8;
+}
+
+inline uint8_t random8(uint8_t min, uint8_t lim) {
+  return random8(lim - min) + min;
+}
+
+inline uint16_t random16() {
+  rand16seed = (rand16seed * 2053) + 13849;
+  return rand16seed;
+}
+
+inline uint16_t random16(uint16_t lim) {
+  return ((uint32_t)random16() * lim) >> 16;
+}
+
+inline void random16_set_seed(uint16_t seed) { rand16seed = seed; }
+inline uint16_t random16_get_seed() { return rand16seed; }
+inline void random16_add_entropy(uint16_t entropy) { rand16seed += entropy; }
+
+
+// Colors
+
+struct CRGB;
+
+struct CHSV {
+  uint8_t hue;
+  uint8_t sat;
+  uint8_t val;
+
+  CHSV() {}
+  CHSV(uint8_t ih, uint8_t is, uint8_t iv) : hue(ih), sat(is), val(iv) {}
+};
+
+void hsv2rgb_rainbow(const CHSV &hsv, CRGB &rgb);
+
+struct CRGB {
+  uint8_t r;
+  uint8_t g;
+  uint8_t b;
+
+  CRGB() {}
+  CRGB(uint8_t ir, uint8_t ig, uint8_t ib) : r(ir), g(ig), b(ib) {}
+  CRGB(uint32_t colorcode) : r((colorcode >> 16) & 0xFF), g((colorcode >> 8) & 0xFF), b(colorcode & 0xFF) {}
+  CRGB(const CHSV &rhs) { hsv2rgb_rainbow(rhs, *this); }
+
+  CRGB &operator=(const CHSV &rhs) {
+    hsv2rgb_rainbow(rhs, *this);
+    return *this;
+  }
+
+  uint8_t &operator[](uint8_t x) { return (&r)[x]; }
+  const uint8_t &operator[](uint8_t x) const { return (&r)[x]; }
+
+  CRGB &operator+=(const CRGB &rhs) {
+    r = qadd8(r, rhs.r);
+    g = qadd8(g, rhs.g);
+    b = qadd8(b, rhs.b);
+    return *this;
+  }
+
+  CRGB &operator-=(const CRGB &rhs) {
+    r = qsub8(r, rhs.r);
+    g = qsub8(g, rhs.g);
+    b = qsub8(b, rhs.b);
+    return *this;
+  }
+
+  CRGB &nscale8(uint8_t scaledown) {
+    r = scale8(r, scaledown);
+    g = scale8(g, scaledown);
+    b = scale8(b, scaledown);
+    return *this;
+  }
+
+  CRGB &fadeToBlackBy(uint8_t fadefactor) {
+    return nscale8(255 - fadefactor);
+  }
+
+  bool operator==(const CRGB &rhs) const { return r == rhs.r && g == rhs.g && b == rhs.b; }
+  bool operator!=(const CRGB &rhs) const { return !(*this == rhs); }
+
+  enum HTMLColorCode {
+    Aqua = 0x00FFFF,
+    Aquamarine = 0x7FFFD4,
+    Black = 0x000000,
+    Blue = 0x0000FF,
+    CadetBlue = 0x5F9EA0,
+    CornflowerBlue = 0x6495ED,
+    Crimson = 0xDC143C,
+    Cyan = 0x00FFFF,
+    DarkBlue = 0x00008B,
+    DarkCyan = 0x008B8B,
+    DarkGreen = 0x006400,
+    DarkOliveGreen = 0x556B2F,
+    DarkOrange = 0xFF8C00,
+    DarkRed = 0x8B0000,
+    DeepPink = 0xFF1493,
+    ForestGreen = 0x228B22,
+    Gold = 0xFFD700,
+    Gray = 0x808080,
+    Green = 0x008000,
+    HotPink = 0xFF69B4,
+    LawnGreen = 0x7CFC00,
+    LightBlue = 0xADD8E6,
+    LightGreen = 0x90EE90,
+    LightGrey = 0xD3D3D3,
+    LightSkyBlue = 0x87CEFA,
+    Lime = 0x00FF00,
+    LimeGreen = 0x32CD32,
+    Magenta = 0xFF00FF,
+    Maroon = 0x800000,
+    MediumAquamarine = 0x66CDAA,
+    MediumBlue = 0x0000CD,
+    MidnightBlue = 0x191970,
+    Navy = 0x000080,
+    OliveDrab = 0x6B8E23,
+    Orange = 0xFFA500,
+    OrangeRed = 0xFF4500,
+    PaleGreen = 0x98FB98,
+    Pink = 0xFFC0CB,
+    Purple = 0x800080,
+    Red = 0xFF0000,
+    Salmon = 0xFA8072,
+    SeaGreen = 0x2E8B57,
+    SkyBlue = 0x87CEEB,
+    Teal = 0x008080,
+    Tomato = 0xFF6347,
+    Violet = 0xEE82EE,
+    White = 0xFFFFFF,
+    Yellow = 0xFFFF00,
+    YellowGreen = 0x9ACD32
+  };
+};
+
+inline CRGB &nblend(CRGB &existing, const CRGB &overlay, uint8_t amountOfOverlay) {
+  if (amountOfOverlay == 0) return existing;
+  if (amountOfOverlay == 255) return existing = overlay;
+  existing.r = blend8(existing.r, overlay.r, amountOfOverlay);
+  existing.g = blend8(existing.g, overlay.g, amountOfOverlay);
+  existing.b = blend8(existing.b, overlay.b, amountOfOverlay);
+  return existing;
+}
+
+
+// Palettes
+
+typedef uint32_t TProgmemRGBPalette16[16];
+
+extern const TProgmemRGBPalette16 CloudColors_p;
+extern const TProgmemRGBPalette16 LavaColors_p;
+extern const TProgmemRGBPalette16 OceanColors_p;
+extern const TProgmemRGBPalette16 ForestColors_p;
+extern const TProgmemRGBPalette16 RainbowColors_p;
+extern const TProgmemRGBPalette16 PartyColors_p;
+extern const TProgmemRGBPalette16 HeatColors_p;
+
+void fill_gradient_RGB(CRGB *leds, uint16_t startpos, CRGB startcolor, uint16_t endpos, CRGB endcolor);
+
+class CRGBPalette16 {
+  public:
+    CRGB entries[16];
+
+    CRGBPalette16() {}
+    CRGBPalette16(const TProgmemRGBPalette16 &rhs) {
+      for (uint8_t i = 0; i < 16; i++) entries[i] = CRGB(rhs[i]);
+    }
+    CRGBPalette16(const CRGB &c1, const CRGB &c2) {
+      fill_gradient_RGB(entries, 0, c1, 15, c2);
+    }
+    CRGBPalette16(const CRGB &c1, const CRGB &c2, const CRGB &c3) {
+      fill_gradient_RGB(entries, 0, c1, 8, c2);
+      fill_gradient_RGB(entries, 8, c2, 15, c3);
+    }
+    CRGBPalette16(const CRGB &c1, const CRGB &c2, const CRGB &c3, const CRGB &c4) {
+      fill_gradient_RGB(entries, 0, c1, 5, c2);
+      fill_gradient_RGB(entries, 5, c2, 10, c3);
+      fill_gradient_RGB(entries, 10, c3, 15, c4);
+    }
+
+    CRGBPalette16 &operator=(const TProgmemRGBPalette16 &rhs) {
+      for (uint8_t i = 0; i < 16; i++) entries[i] = CRGB(rhs[i]);
+      return *this;
+    }
+
+    CRGB &operator[](uint8_t x) { return entries[x]; }
+    const CRGB &operator[](uint8_t x) const { return entries[x]; }
+};
+
+typedef enum { NOBLEND = 0, LINEARBLEND = 1 } TBlendType;
+
+CRGB ColorFromPalette(const CRGBPalette16 &pal, uint8_t index, uint8_t brightness = 255, TBlendType blendType = LINEARBLEND);
+
+
+// LED controller
+
+enum EOrder { RGB = 0012, RBG = 0021, GRB = 0102, GBR = 0120, BRG = 0201, BGR = 0210 };
+
+template <uint8_t DATA_PIN, EOrder RGB_ORDER> class WS2811 {};
+template <uint8_t DATA_PIN, EOrder RGB_ORDER> class WS2812B {};
+
+// WS2811 at 800 kHz: 24 bits of 1.25 us per LED plus the 50 us latch
+#define WS2811_LED_US 30
+#define WS2811_LATCH_US 50
+
+typedef void (*HostShowHook)(const CRGB *leds, int count, uint8_t brightness);
+
+class CFastLED {
+  public:
+    CFastLED() : m_leds(0), m_count(0), m_brightness(255), m_showCount(0), m_showHook(0) {}
+
+    template <template <uint8_t DATA_PIN, EOrder RGB_ORDER> class CHIPSET, uint8_t DATA_PIN, EOrder RGB_ORDER>
+    CFastLED &addLeds(CRGB *data, int nLedsOrOffset, int nLedsIfOffset = 0) {
+      if (nLedsIfOffset > 0) {
+        m_leds = data + nLedsOrOffset;
+        m_count = nLedsIfOffset;
+      } else {
+        m_leds = data;
+        m_count = nLedsOrOffset;
+      }
+      return *this;
+    }
+
+    void setBrightness(uint8_t scale) { m_brightness = scale; }
+    uint8_t getBrightness() { return m_brightness; }
+    void setDither(uint8_t ditherMode) {}
+
+    void show();
+    void clear(bool writeData = false);
+
+    // host side
+    void setShowHook(HostShowHook hook) { m_showHook = hook; }
+    uint32_t showCount() { return m_showCount; }
+    CRGB *leds() { return m_leds; }
+    int size() { return m_count; }
+
+  private:
+    CRGB *m_leds;
+    int m_count;
+    uint8_t m_brightness;
+    uint32_t m_showCount;
+    HostShowHook m_showHook;
+};
+
+extern CFastLED FastLED;
+
+#endif
@@ -0,0 +1,24 @@
+// Flash access for the host build: everything is in ordinary memory
+//
+// The sketch stores flash addresses in 16/32-bit integers (see
+// selectFlashString), so the host executable is linked non-PIE to keep
+// static data below 4 GB.
+
+#ifndef HOST_PGMSPACE_H
+#define HOST_PGMSPACE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s) (s)
+
+template <class T> inline uintptr_t hostPgmReadWord(const T *addr) {
+  return (uintptr_t)*addr;
+}
+
+#define pgm_read_byte(addr) (*(const uint8_t *)(uintptr_t)(addr))
+#define pgm_read_word(addr) hostPgmReadWord(addr)
+#define memcpy_P(dest, src, n) memcpy((dest), (src), (n))
+
+#endif
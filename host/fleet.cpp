@@ -0,0 +1,319 @@
+// Fleet renderer: many virtual RGB Shades rendered in parallel
+//
+// Every unit runs the whole sketch from power on, on its own copy of the
+// sketch's state (see fleet.h), for --frames effect frames. All units hear
+// the same MSGEQ7 trace, each starting at a different point in it, and get
+// their own random seed, so a fleet at an event can be previewed and
+// regression-tested offline. Units are spread over worker threads, each
+// with a queue of its own; a worker that runs out takes units from the
+// other end of another worker's queue.
+//
+//   rgbshades_fleet [--units N] [--frames N] [--threads N] [--trace FILE] [--row-ms N]
+//                   [--spread MS] [--seed N] [--effect NAME] [--output FILE]
+//                   [--reference FILE] [--scale]
+//
+//   --units N         units in the fleet (default 64)
+//   --frames N        effect frames per unit (default 300)
+//   --threads N       worker threads (default one per core, at most FLEET_SLOTS)
+//   --trace FILE      MSGEQ7 trace, rows of seven 10-bit values as in bench/spectrum.txt
+//                     (default bench/spectrum.txt), played in a loop
+//   --row-ms N        milliseconds per trace row (default 9, one doAnalogs() call)
+//   --spread MS       each unit starts MS further into the trace than the one
+//                     before (default: spread evenly over one pass of the trace)
+//   --seed N          unit n gets random seed N + n (default 1337)
+//   --effect NAME     run every unit on this effect instead of the effect lists
+//   --output FILE     write the fleet's frames to FILE
+//   --reference FILE  compare the frames with an earlier --output and fail on any
+//                     difference, listing the first differing frame of each unit
+//   --scale           run the fleet with 1, 2, 4... up to --threads threads and
+//                     print units/s against thread count
+//
+// Output format: "RGBFLEET", uint32 little-endian units, frames and LEDs per
+// frame, then the red, green and blue planes of FleetOutput (see fleet.h).
+
+#include "fleet.h"
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+const FleetSlot *fleetSlots[FLEET_MAX_SLOTS];
+unsigned char *fleetPristine[FLEET_MAX_SLOTS];
+
+struct WorkQueue {
+  std::mutex lock;
+  std::deque<uint32_t> units;
+};
+
+struct FleetJob {
+  const FleetTrace *trace;
+  const std::vector<FleetUnit> *units;
+  const char *effect;
+  FleetOutput *output;
+  std::vector<WorkQueue> *queues;
+  bool failed;
+};
+
+static bool loadTrace(const char *path, std::vector<uint16_t> &values) {
+  FILE *f = fopen(path, "r");
+  if (!f) {
+    perror(path);
+    return false;
+  }
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    unsigned v[7];
+    if (line[0] == '#') continue;
+    if (sscanf(line, "%u %u %u %u %u %u %u", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6]) != 7) continue;
+    for (int band = 0; band < 7; band++) values.push_back(v[band] > 1023 ? 1023 : v[band]);
+  }
+  fclose(f);
+  if (values.empty()) {
+    fprintf(stderr, "%s: no spectrum rows\n", path);
+    return false;
+  }
+  return true;
+}
+
+// A unit from the worker's own queue, newest first, or else the oldest from another's
+static bool takeUnit(std::vector<WorkQueue> &queues, unsigned self, uint32_t &unit) {
+  for (unsigned n = 0; n < queues.size(); n++) {
+    WorkQueue &q = queues[(self + n) % queues.size()];
+    std::lock_guard<std::mutex> hold(q.lock);
+    if (q.units.empty()) continue;
+    if (n == 0) {
+      unit = q.units.back();
+      q.units.pop_back();
+    } else {
+      unit = q.units.front();
+      q.units.pop_front();
+    }
+    return true;
+  }
+  return false;
+}
+
+static void worker(FleetJob *job, unsigned self) {
+  const FleetSlot *slot = fleetSlots[self];
+  uint32_t unit;
+  while (takeUnit(*job->queues, self, unit)) {
+    slot->reset();
+    if (!slot->run(job->trace, &(*job->units)[unit], job->effect, job->output)) job->failed = true;
+  }
+}
+
+// Render the whole fleet on threads workers, false if the effect wasn't found
+static bool renderFleet(const FleetTrace *trace, const std::vector<FleetUnit> &units, const char *effect,
+                        FleetOutput *output, unsigned threads) {
+  std::vector<WorkQueue> queues(threads);
+  for (uint32_t u = 0; u < units.size(); u++) queues[(uint64_t)u * threads / units.size()].units.push_back(u);
+
+  FleetJob job = {trace, &units, effect, output, &queues, false};
+  std::vector<std::thread> workers;
+  for (unsigned t = 1; t < threads; t++) workers.push_back(std::thread(worker, &job, t));
+  worker(&job, 0);
+  for (size_t t = 0; t < workers.size(); t++) workers[t].join();
+  return !job.failed;
+}
+
+static uint32_t fleetHash(const FleetOutput &output, size_t plane) {
+  uint32_t hash = 2166136261UL;
+  const uint8_t *planes[3] = {output.r, output.g, output.b};
+  for (int c = 0; c < 3; c++) {
+    for (size_t i = 0; i < plane; i++) {
+      hash ^= planes[c][i];
+      hash *= 16777619UL;
+    }
+  }
+  return hash;
+}
+
+static void put32(FILE *f, uint32_t v) {
+  uint8_t bytes[4] = {(uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24)};
+  fwrite(bytes, 1, 4, f);
+}
+
+static uint32_t get32(const uint8_t *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool writeOutput(const char *path, const FleetOutput &output, size_t plane) {
+  FILE *f = fopen(path, "wb");
+  if (!f) {
+    perror(path);
+    return false;
+  }
+  fwrite("RGBFLEET", 1, 8, f);
+  put32(f, output.units);
+  put32(f, output.frames);
+  put32(f, FLEET_LEDS);
+  fwrite(output.r, 1, plane, f);
+  fwrite(output.g, 1, plane, f);
+  fwrite(output.b, 1, plane, f);
+  fclose(f);
+  return true;
+}
+
+// Compare with an earlier --output, unit by unit; each unit's frames are one run in each plane
+static bool compareOutput(const char *path, const FleetOutput &output, size_t plane) {
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    perror(path);
+    return false;
+  }
+  std::vector<uint8_t> data;
+  uint8_t buffer[65536];
+  size_t length;
+  while ((length = fread(buffer, 1, sizeof(buffer), f)) > 0) data.insert(data.end(), buffer, buffer + length);
+  fclose(f);
+
+  if (data.size() < 20 || memcmp(&data[0], "RGBFLEET", 8) || get32(&data[8]) != output.units ||
+      get32(&data[12]) != output.frames || get32(&data[16]) != FLEET_LEDS || data.size() != 20 + plane * 3) {
+    fprintf(stderr, "%s: not a fleet of %u units x %u frames\n", path, output.units, output.frames);
+    return false;
+  }
+
+  const uint8_t *planes[3] = {output.r, output.g, output.b};
+  size_t unitBytes = (size_t)output.frames * FLEET_LEDS;
+  uint32_t differing = 0;
+  for (uint32_t u = 0; u < output.units; u++) {
+    uint32_t firstFrame = output.frames;
+    int maxDifference = 0;
+    for (int c = 0; c < 3; c++) {
+      const uint8_t *mine = planes[c] + u * unitBytes;
+      const uint8_t *theirs = &data[20 + c * plane + u * unitBytes];
+      if (!memcmp(mine, theirs, unitBytes)) continue;
+      for (size_t i = 0; i < unitBytes; i++) {
+        int difference = abs(mine[i] - theirs[i]);
+        if (!difference) continue;
+        if (i / FLEET_LEDS < firstFrame) firstFrame = i / FLEET_LEDS;
+        if (difference > maxDifference) maxDifference = difference;
+      }
+    }
+    if (firstFrame == output.frames) continue;
+    if (differing++ < 20) printf("unit %u: differs from frame %u, max difference %d\n", u, firstFrame, maxDifference);
+  }
+  printf("%u of %u units differ from %s\n", differing, output.units, path);
+  return differing == 0;
+}
+
+int main(int argc, char **argv) {
+  uint32_t unitCount = 64;
+  uint32_t frames = 300;
+  unsigned threads = std::thread::hardware_concurrency();
+  const char *tracePath = FLEET_DEFAULT_TRACE;
+  uint32_t rowMillis = 9;
+  long spreadMillis = -1;
+  uint32_t seed = 1337;
+  const char *effect = 0;
+  const char *outputPath = 0;
+  const char *referencePath = 0;
+  bool scale = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--units") && i + 1 < argc) {
+      unitCount = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+      frames = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+      threads = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--trace") && i + 1 < argc) {
+      tracePath = argv[++i];
+    } else if (!strcmp(argv[i], "--row-ms") && i + 1 < argc) {
+      rowMillis = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--spread") && i + 1 < argc) {
+      spreadMillis = atol(argv[++i]);
+    } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+      seed = strtoul(argv[++i], 0, 0);
+    } else if (!strcmp(argv[i], "--effect") && i + 1 < argc) {
+      effect = argv[++i];
+    } else if (!strcmp(argv[i], "--output") && i + 1 < argc) {
+      outputPath = argv[++i];
+    } else if (!strcmp(argv[i], "--reference") && i + 1 < argc) {
+      referencePath = argv[++i];
+    } else if (!strcmp(argv[i], "--scale")) {
+      scale = true;
+    } else {
+      fprintf(stderr, "usage: %s [--units N] [--frames N] [--threads N] [--trace FILE] [--row-ms N] "
+              "[--spread MS] [--seed N] [--effect NAME] [--output FILE] [--reference FILE] [--scale]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  unsigned slots = 0;
+  while (slots < FLEET_MAX_SLOTS && fleetSlots[slots]) slots++;
+  for (unsigned s = 0; s < slots; s++) {
+    const char *problem = fleetSlots[s]->check();
+    if (problem) {
+      fprintf(stderr, "fleet slot %u: %s\n", s, problem);
+      return 1;
+    }
+  }
+  if (threads < 1) threads = 1;
+  if (threads > slots) {
+    fprintf(stderr, "%u threads, but only %u slots are built in (FLEET_SLOTS), using %u\n", threads, slots, slots);
+    threads = slots;
+  }
+  if (!unitCount || !frames || !rowMillis) {
+    fprintf(stderr, "--units, --frames and --row-ms must be at least 1\n");
+    return 2;
+  }
+
+  std::vector<uint16_t> traceValues;
+  if (!loadTrace(tracePath, traceValues)) return 1;
+  FleetTrace trace = {(const uint16_t (*)[7])&traceValues[0], (uint32_t)(traceValues.size() / 7), rowMillis * 1000};
+
+  uint64_t traceMicros = (uint64_t)trace.count * trace.rowMicros;
+  std::vector<FleetUnit> units(unitCount);
+  for (uint32_t u = 0; u < unitCount; u++) {
+    units[u].index = u;
+    units[u].seed = seed + u;
+    units[u].offsetMicros = spreadMillis >= 0 ? (uint64_t)u * spreadMillis * 1000 : traceMicros * u / unitCount;
+  }
+
+  size_t plane = (size_t)unitCount * frames * FLEET_LEDS;
+  std::vector<uint8_t> r(plane), g(plane), b(plane);
+  FleetOutput output = {unitCount, frames, &r[0], &g[0], &b[0]};
+
+  std::vector<unsigned> runs;
+  if (scale) {
+    for (unsigned t = 1; t < threads; t *= 2) runs.push_back(t);
+  }
+  runs.push_back(threads);
+
+  double baseRate = 0;
+  uint32_t firstHash = 0;
+  if (scale) printf("%8s %10s %10s %8s\n", "threads", "seconds", "units/s", "speedup");
+  for (size_t n = 0; n < runs.size(); n++) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if (!renderFleet(&trace, units, effect, &output, runs[n])) {
+      fprintf(stderr, "no effect called %s\n", effect);
+      return 2;
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1e6;
+    double rate = seconds > 0 ? unitCount / seconds : 0;
+    uint32_t hash = fleetHash(output, plane);
+    if (n == 0) {
+      baseRate = rate;
+      firstHash = hash;
+    } else if (hash != firstHash) {
+      fprintf(stderr, "frames on %u threads differ from those on %u\n", runs[n], runs[0]);
+      return 1;
+    }
+    if (scale) printf("%8u %10.3f %10.1f %7.2fx\n", runs[n], seconds, rate, baseRate > 0 ? rate / baseRate : 0);
+    else printf("%u units x %u frames on %u threads in %.3f s, %.1f units/s\n",
+                unitCount, frames, runs[n], seconds, rate);
+  }
+  printf("fleet hash %08X\n", firstHash);
+
+  int status = 0;
+  if (outputPath && !writeOutput(outputPath, output, plane)) status = 1;
+  if (referencePath && !compareOutput(referencePath, output, plane)) status = 1;
+  return status;
+}
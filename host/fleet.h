@@ -0,0 +1,57 @@
+// Fleet renderer: many virtual shades at once (see fleet.cpp)
+//
+// The sketch keeps its state in globals and function statics, so a unit
+// can't be an object. Instead, fleet_slot.cpp compiles the sketch and the
+// host Arduino/FastLED layer into an anonymous namespace, once per slot
+// (FLEET_SLOTS in CMakeLists.txt), and each worker thread owns a slot. A
+// slot runs one unit from power on to its last frame, then puts its memory
+// back the way it was before the first unit ran and takes the next one.
+
+#ifndef HOST_FLEET_H
+#define HOST_FLEET_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define FLEET_LEDS 68 // LAST_VISIBLE_LED + 1, checked by the slots
+
+// A shared MSGEQ7 trace, one row of seven 10-bit values every rowMicros
+struct FleetTrace {
+  const uint16_t (*rows)[7];
+  uint32_t count;
+  uint32_t rowMicros;
+};
+
+struct FleetUnit {
+  uint32_t index;
+  uint32_t seed;         // random16 seed after setup()
+  uint64_t offsetMicros; // where in the trace the unit starts
+};
+
+// Effect frames, structure of arrays: one plane per channel, each unit's
+// frames one after another in it, so plane[(unit * frames + frame) * FLEET_LEDS + led]
+struct FleetOutput {
+  uint32_t units;
+  uint32_t frames;
+  uint8_t *r;
+  uint8_t *g;
+  uint8_t *b;
+};
+
+struct FleetSlot {
+  const char *(*check)();  // why the slot can't be used, or 0
+  void (*reset)();         // back to the state before any unit ran
+  // Power up a unit and run it for output->frames effect frames, all on
+  // effect if it isn't 0. False if there's no effect by that name.
+  bool (*run)(const FleetTrace *trace, const FleetUnit *unit, const char *effect, FleetOutput *output);
+};
+
+#define FLEET_MAX_SLOTS 256
+
+extern const FleetSlot *fleetSlots[FLEET_MAX_SLOTS];
+
+struct FleetRegister {
+  FleetRegister(int slot, const FleetSlot *s) { fleetSlots[slot] = s; }
+};
+
+#endif
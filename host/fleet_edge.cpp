@@ -0,0 +1,10 @@
+// Markers around a fleet slot's memory (see fleet_slot.cpp), built twice per
+// slot: FLEET_EDGE Begin before the slot's object on the link line, End after.
+// The linker keeps the .data and .bss of each object together and in link
+// order, so the slot's globals land between the two.
+
+#define FLEET_PASTE(name, edge, slot) name##edge##slot
+#define FLEET_NAME(name, edge, slot) FLEET_PASTE(name, edge, slot)
+
+char FLEET_NAME(fleetData, FLEET_EDGE, FLEET_SLOT) = 1;
+char FLEET_NAME(fleetBss, FLEET_EDGE, FLEET_SLOT);
@@ -0,0 +1,128 @@
+// One fleet slot: the sketch and the host Arduino/FastLED layer, unchanged,
+// in an anonymous namespace so that every copy of this file (FLEET_SLOT = 0,
+// 1, ...) has globals of its own.
+//
+// All of a slot's state is then in this object's .data and .bss, which the
+// linker puts between fleet_edge.cpp built as the slot's begin and end
+// markers (CMakeLists.txt links them in that order, and check() makes sure).
+// reset() copies back what was there before the first unit ran, statics in
+// functions included. The one thing on the heap is the Serial input queue
+// in Arduino.cpp, a std::deque; units get no Serial input, so it never
+// reallocates and copying it back is safe.
+
+// everything the sketch and host layer include, outside the namespace so the
+// include guards keep them there
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+#include <cmath>
+#include <cstdlib>
+#include <deque>
+#include <vector>
+
+#include "fleet.h"
+
+#define FLEET_PASTE(name, slot) name##slot
+#define FLEET_NAME(name, slot) FLEET_PASTE(name, slot)
+
+extern char FLEET_NAME(fleetDataBegin, FLEET_SLOT), FLEET_NAME(fleetDataEnd, FLEET_SLOT);
+extern char FLEET_NAME(fleetBssBegin, FLEET_SLOT), FLEET_NAME(fleetBssEnd, FLEET_SLOT);
+
+extern unsigned char *fleetPristine[FLEET_MAX_SLOTS];
+
+namespace {
+
+#include "Arduino.cpp"
+#include "FastLED.cpp"
+#include "../RGBShadesAudio.ino"
+#include "hosteffects.h"
+
+// Rough time of a pass of loop() that doesn't render or show anything, as in main.cpp
+#define IDLE_LOOP_US 20
+
+const FleetTrace *slotTrace;
+uint64_t slotOffset;
+
+uint16_t traceSpectrum(uint8_t band, uint64_t micros) {
+  uint64_t row = (micros + slotOffset) / slotTrace->rowMicros;
+  return slotTrace->rows[row % slotTrace->count][band];
+}
+
+char *dataBegin() { return &FLEET_NAME(fleetDataBegin, FLEET_SLOT); }
+size_t dataSize() { return &FLEET_NAME(fleetDataEnd, FLEET_SLOT) - dataBegin(); }
+char *bssBegin() { return &FLEET_NAME(fleetBssBegin, FLEET_SLOT); }
+size_t bssSize() { return &FLEET_NAME(fleetBssEnd, FLEET_SLOT) - bssBegin(); }
+
+bool inSlot(const void *p) {
+  const char *c = (const char *)p;
+  return (c > dataBegin() && c < dataBegin() + dataSize()) || (c > bssBegin() && c < bssBegin() + bssSize());
+}
+
+const char *slotCheck() {
+  if (LAST_VISIBLE_LED + 1 != FLEET_LEDS) return "FLEET_LEDS doesn't match LAST_VISIBLE_LED";
+  if (!inSlot(&leds) || !inSlot(&hostMicros) || !inSlot(&Serial) || !inSlot(&effectInit) || !inSlot(&slotOffset)) {
+    return "slot memory isn't between its markers, check the link order";
+  }
+  if (!fleetPristine[FLEET_SLOT]) {
+    fleetPristine[FLEET_SLOT] = new unsigned char[dataSize() + bssSize()];
+    memcpy(fleetPristine[FLEET_SLOT], dataBegin(), dataSize());
+    memcpy(fleetPristine[FLEET_SLOT] + dataSize(), bssBegin(), bssSize());
+  }
+  return 0;
+}
+
+void slotReset() {
+  memcpy(dataBegin(), fleetPristine[FLEET_SLOT], dataSize());
+  memcpy(bssBegin(), fleetPristine[FLEET_SLOT] + dataSize(), bssSize());
+}
+
+bool slotRun(const FleetTrace *trace, const FleetUnit *unit, const char *effect, FleetOutput *output) {
+  functionList only = 0;
+  if (effect) {
+    for (unsigned i = 0; i < NUM_HOST_EFFECTS; i++) {
+      if (!strcmp(effect, hostEffects[i].name)) only = hostEffects[i].effect;
+    }
+    if (!only) return false;
+  }
+
+  slotTrace = trace;
+  slotOffset = unit->offsetMicros;
+  hostSetSpectrumSource(traceSpectrum);
+  setup();
+  random16_set_seed(unit->seed);
+  if (only) {
+    // as runSweep() in main.cpp: borrow the first slot of the non-audio list
+    effectListNoAudio[0] = only;
+    audioEnabled = false;
+    autoCycle = false;
+    currentEffect = 0;
+    effectInit = false;
+  }
+
+  size_t start = (size_t)unit->index * output->frames * FLEET_LEDS;
+  uint8_t *r = output->r + start;
+  uint8_t *g = output->g + start;
+  uint8_t *b = output->b + start;
+  uint32_t frame = 0;
+  while (frame < output->frames) {
+    unsigned long lastEffectMillis = effectMillis;
+    uint64_t startMicros = hostMicros;
+    loop();
+    if (hostMicros == startMicros) hostAdvance(IDLE_LOOP_US);
+    if (effectMillis == lastEffectMillis) continue;
+    for (byte i = 0; i < FLEET_LEDS; i++) {
+      *r++ = leds[i].r;
+      *g++ = leds[i].g;
+      *b++ = leds[i].b;
+    }
+    frame++;
+  }
+  return true;
+}
+
+const FleetSlot slot = {slotCheck, slotReset, slotRun};
+FleetRegister slotRegister(FLEET_SLOT, &slot);
+
+}
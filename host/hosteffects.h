@@ -0,0 +1,52 @@
+// Every effect in effects.h by name, whether or not it is in one of the
+// effect lists, for the host runners. Included after the sketch.
+
+#ifndef HOST_HOSTEFFECTS_H
+#define HOST_HOSTEFFECTS_H
+
+struct HostEffect {
+  const char *name;
+  functionList effect;
+};
+
+static const HostEffect hostEffects[] = {
+  {"threeSine", threeSine},
+  {"plasma", plasma},
+  {"rider", rider},
+  {"glitter", glitter},
+  {"colorFill", colorFill},
+  {"threeDee", threeDee},
+  {"sideRain", sideRain},
+  {"confetti", confetti},
+  {"slantBars", slantBars},
+  {"scrollTextZero", scrollTextZero},
+  {"scrollTextOne", scrollTextOne},
+  {"scrollTextTwo", scrollTextTwo},
+  {"drawAnalyzer", drawAnalyzer},
+  {"drawVU", drawVU},
+  {"RGBpulse", RGBpulse},
+  {"audioPlasma", audioPlasma},
+  {"audioCirc", audioCirc},
+  {"audioSpin", audioSpin},
+  {"audioStripes", audioStripes},
+  {"shadesOutline", shadesOutline},
+  {"audioShadesOutline", audioShadesOutline},
+  {"comets", comets},
+  {"hearts", hearts},
+  {"rings", rings},
+  {"noiseFlyer", noiseFlyer},
+  {"ramMeter", ramMeter},
+  {"plasmaVU", plasmaVU},
+  {"fireflies", fireflies},
+  {"beatSparks", beatSparks},
+  {"waterfall", waterfall},
+#ifdef VM
+  {"vmThreeSine", vmThreeSine},
+  {"vmSlantBars", vmSlantBars},
+  {"vmEffect0", vmEffect0},
+#endif
+};
+
+#define NUM_HOST_EFFECTS (sizeof(hostEffects) / sizeof(hostEffects[0]))
+
+#endif
@@ -0,0 +1,709 @@
+// Headless host runner for the RGB Shades sketch
+//
+// Compiles RGBShadesAudio.ino and its headers unchanged against the host
+// Arduino/FastLED layer and runs setup()/loop() on the virtual clock.
+//
+//   rgbshades_host [--seconds N] [--sweep FRAMES] [--dump FILE] [--eeprom FILE]
+//                  [--serial FILE] [--input FILE] [--reference FILE [--tolerance N]]
+//                  [--effect NAME] [--bake FILE] [--blur N] [--bloom N]
+//                  [--wav FILE [--wav-gain G] [--beats [--beat-times FILE]] [--levels FILE]]
+//
+//   --seconds N       run the sketch for N seconds of virtual time (default 60)
+//   --sweep FRAMES    instead, run every effect in effects.h for FRAMES effect frames
+//   --dump FILE       write every shown frame to FILE
+//   --eeprom FILE     load EEPROM contents from FILE and save them back on exit
+//   --serial FILE     write the sketch's Serial output to FILE
+//   --input FILE      send the contents of FILE to the sketch's Serial after setup()
+//   --reference FILE  compare every shown frame with a dump from an earlier run and
+//                     fail if any channel differs by more than --tolerance (default 0);
+//                     the largest difference and frames over it are listed per effect
+//   --effect NAME     with --sweep, run only this effect
+//   --bake FILE       with --sweep, write the LEDs after each effect frame to FILE, in the
+//                     dump format but stamped with effectDelay (see tools/bake.py)
+//   --blur N          blur every effect frame by N (0-255, see blur.h), from each effect's
+//                     second frame on; with --dump, compare against a run without it
+//                     using tools/shadesview.py --dump
+//   --bloom N         the same with bloom, over bloomThreshold
+//   --wav FILE        feed the MSGEQ7 from a WAV file through the model in msgeq7.h
+//                     instead of the synthetic beat; --seconds defaults to its length
+//   --wav-gain G      scale the WAV by G first (default 2, about line level)
+//   --beats           instead of running the sketch, put every --wav (there can be
+//                     many) through doAnalogs() and beatDetect() at the loop's cadence
+//                     from power-on state, and report beats and songs per minute
+//   --beat-times FILE with --beats, write "file,milliseconds" for every beat to FILE
+//   --levels FILE     instead of running the sketch, write the MSGEQ7 levels of the
+//                     --wav to FILE, a row every 10 ms as in bench/spectrum.txt (for
+//                     tools/show.py)
+//
+// The rgbshades_deterministic build (-DDETERMINISTIC) also takes
+//
+//   --golden DIR        sweep all effects and check each frame hash against DIR/<effect>.txt
+//   --write-golden DIR  sweep all effects and write their frame hashes to DIR
+//
+// The rgbshades_tuning build (-DTUNING) also takes
+//
+//   --beat-check        run beatDetect() at the default, a middle and the highest AGCSMOOTH
+//                       against a double-precision average, and fail if it strays
+//
+// The rgbshades_adalight build (-DADALIGHT) also takes
+//
+//   --adalight FPS      for --seconds, send Adalight frames at FPS (as fast as the baud rate
+//                       allows if that is lower) and report how many were shown intact and
+//                       how long from their last byte arriving to the end of show()
+//
+// Frame dump format, one record per FastLED.show():
+//   uint32 little-endian virtual milliseconds, then 68 x RGB bytes (leds[0..67])
+
+#include "Arduino.h"
+#include "../RGBShadesAudio.ino"
+#include "hosteffects.h"
+#include "msgeq7.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+struct EffectTiming {
+  uint32_t frames;
+  uint64_t loopNanos;
+  uint64_t virtualMicros;
+  uint64_t sleptMicros;
+  int maxDifference;       // from the --reference dump
+  uint32_t overTolerance;
+};
+
+#define FRAME_BYTES ((LAST_VISIBLE_LED + 1) * 3)
+#define GOLDEN_FRAMES 100
+
+static EffectTiming timings[NUM_HOST_EFFECTS];
+static FILE *dumpFile = 0;
+static FILE *bakeFile = 0;
+static const char *onlyEffect = 0;
+static int forceBlur = -1;
+static int forceBloom = -1;
+
+static Msgeq7Track wavTrack;
+static uint64_t wavStartMicros = 0;
+
+static FILE *referenceFile = 0;
+static int tolerance = 0;
+static int maxDifference = 0;
+static uint32_t framesCompared = 0;
+static uint32_t framesOverTolerance = 0;
+
+static bool recordHashes = false;
+static std::vector<uint32_t> effectHashes[NUM_HOST_EFFECTS];
+
+static int effectIndex(functionList effect) {
+  for (unsigned i = 0; i < NUM_HOST_EFFECTS; i++) {
+    if (hostEffects[i].effect == effect) return i;
+  }
+  return -1;
+}
+
+static functionList runningEffect() {
+  return audioEnabled ? effectListAudio[currentEffect] : effectListNoAudio[currentEffect];
+}
+
+// Compare a shown frame with the next one in the reference dump
+static void compareFrame(const CRGB *frame) {
+  uint8_t record[4 + FRAME_BYTES];
+  if (fread(record, 1, sizeof(record), referenceFile) != sizeof(record)) return;
+
+  const uint8_t *shown = (const uint8_t *)frame;
+  int difference = 0;
+  for (int i = 0; i < FRAME_BYTES; i++) {
+    int d = abs(shown[i] - record[4 + i]);
+    if (d > difference) difference = d;
+  }
+
+  framesCompared++;
+  if (difference > maxDifference) maxDifference = difference;
+  if (difference > tolerance) framesOverTolerance++;
+
+  int i = effectIndex(runningEffect());
+  if (i < 0) return;
+  if (difference > timings[i].maxDifference) timings[i].maxDifference = difference;
+  if (difference > tolerance) timings[i].overTolerance++;
+}
+
+#ifdef ADALIGHT
+
+static bool adalightTest = false;
+static std::vector<uint64_t> adaArrivals; // when the last byte of each frame sent arrives
+static uint32_t adaShown = 0;
+static uint32_t adaTorn = 0;
+static uint64_t adaLatencyTotal = 0;
+static uint64_t adaLatencyMax = 0;
+
+// Frame n of the test, n is in the first LED so a shown frame can be matched to its arrival
+static void adalightPattern(uint16_t n, uint8_t *rgb) {
+  rgb[0] = n;
+  rgb[1] = n >> 8;
+  rgb[2] = 0xA5;
+  for (int i = 3; i < FRAME_BYTES; i++) rgb[i] = n * 7 + i;
+}
+
+static void adalightShowFrame(const CRGB *frame) {
+  if (!adalightRunning()) return;
+  const uint8_t *shown = (const uint8_t *)frame;
+  uint16_t n = shown[0] | shown[1] << 8;
+  uint8_t expected[FRAME_BYTES];
+  adalightPattern(n, expected);
+  if (n >= adaArrivals.size() || memcmp(shown, expected, FRAME_BYTES)) {
+    adaTorn++;
+    return;
+  }
+  uint64_t latency = hostMicros + (LAST_VISIBLE_LED + 1) * WS2811_LED_US + WS2811_LATCH_US - adaArrivals[n];
+  adaShown++;
+  adaLatencyTotal += latency;
+  if (latency > adaLatencyMax) adaLatencyMax = latency;
+}
+
+#endif
+
+static void writeFrame(FILE *file, uint32_t stamp, const CRGB *frame) {
+  uint8_t bytes[4] = { (uint8_t)stamp, (uint8_t)(stamp >> 8), (uint8_t)(stamp >> 16), (uint8_t)(stamp >> 24) };
+  fwrite(bytes, 1, sizeof(bytes), file);
+  fwrite(frame, 1, FRAME_BYTES, file);
+}
+
+static void showFrame(const CRGB *frame, int count, uint8_t brightness) {
+  if (referenceFile) compareFrame(frame);
+#ifdef ADALIGHT
+  if (adalightTest) adalightShowFrame(frame);
+#endif
+  if (dumpFile) writeFrame(dumpFile, hostMicros / 1000, frame);
+}
+
+// Rough time of a pass of loop() on the shades that doesn't render or show anything
+#define IDLE_LOOP_US 20
+
+// Run loop() once, charging its wall-clock time to the effect if it rendered a frame
+static bool timedLoop() {
+  unsigned long lastEffectMillis = effectMillis;
+  uint64_t startMicros = hostMicros;
+  uint32_t startIdle = idleMicros;
+  if (forceBlur >= 0) blurAmount = forceBlur;
+  if (forceBloom >= 0) bloomAmount = forceBloom;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  loop();
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+  if (hostMicros == startMicros) hostAdvance(IDLE_LOOP_US); // nothing modeled ran, the pass still takes time
+
+  bool rendered = (effectMillis != lastEffectMillis);
+  int i = effectIndex(runningEffect());
+  if (i >= 0) {
+    timings[i].virtualMicros += hostMicros - startMicros;
+    timings[i].sleptMicros += (uint32_t)(idleMicros - startIdle);
+    timings[i].loopNanos += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    if (rendered) timings[i].frames++;
+  }
+  return rendered;
+}
+
+static uint16_t wavSpectrum(uint8_t band, uint64_t micros) {
+  return msgeq7Level(wavTrack, band, micros - wavStartMicros);
+}
+
+// Put each WAV through the audio path on its own, without the effects, as
+// loop() would: doAnalogs() every AUDIODELAY + 1 ms and beatDetect() after it
+static bool runBeats(const std::vector<const char *> &paths, float gain, FILE *times) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  hostSetSpectrumSource(wavSpectrum);
+  uint32_t songs = 0;
+  double audioSeconds = 0;
+  bool ok = true;
+
+  for (size_t n = 0; n < paths.size(); n++) {
+    Msgeq7Audio audio;
+    std::string error;
+    if (!msgeq7LoadWav(paths[n], audio, error)) {
+      fprintf(stderr, "%s: %s\n", paths[n], error.c_str());
+      ok = false;
+      continue;
+    }
+    msgeq7Process(audio, gain, wavTrack);
+
+    // the audio state at power on
+    for (byte b = 0; b < 7; b++) spectrumDecay[b] = spectrumDecayFine[b] = spectrumPeaks[b] = 0;
+    audioAvg = 300.0;
+    gainAGC = 1.0;
+    beatTriggered = 0;
+    lastBeatVal = beatAvg = 0;
+    lastBeatMillis = 0;
+
+    wavStartMicros = hostMicros;
+    uint32_t beats = 0;
+    for (uint64_t t = 0; t < (uint64_t)wavTrack.millis * 1000; t += (AUDIODELAY + 1) * 1000) {
+      if (hostMicros < wavStartMicros + t) hostAdvance(wavStartMicros + t - hostMicros);
+      currentMillis = millis();
+      doAnalogs();
+      if (beatDetect()) {
+        beats++;
+        if (times) fprintf(times, "%s,%lu\n", paths[n], (unsigned long)(t / 1000));
+      }
+    }
+
+    double seconds = wavTrack.millis / 1000.0;
+    printf("%s: %.1f s, %u beats, %.1f a minute\n", paths[n], seconds, beats, seconds > 0 ? beats * 60 / seconds : 0);
+    songs++;
+    audioSeconds += seconds;
+  }
+
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+  double wall = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1e6;
+  printf("%u songs, %.1f minutes of audio in %.3f s: %.0f songs a minute, %.0fx real time\n",
+         songs, audioSeconds / 60, wall, wall > 0 ? songs * 60 / wall : 0, wall > 0 ? audioSeconds / wall : 0);
+  return ok;
+}
+
+// The track in the format of bench/spectrum.txt, a row every LEVELSMS
+#define LEVELSMS 10
+static bool writeLevels(const char *path, const char *wav) {
+  FILE *f = fopen(path, "w");
+  if (!f) {
+    perror(path);
+    return false;
+  }
+  fprintf(f, "# MSGEQ7 levels of %s from host/msgeq7.h, one row every %d ms\n", wav, LEVELSMS);
+  fprintf(f, "# 63Hz 160Hz 400Hz 1kHz 2.5kHz 6.25kHz 16kHz (10-bit ADC counts)\n");
+  for (uint32_t ms = 0; ms < wavTrack.millis; ms += LEVELSMS) {
+    for (uint8_t band = 0; band < MSGEQ7_BANDS; band++) {
+      fprintf(f, band ? " %u" : "%u", msgeq7Level(wavTrack, band, (uint64_t)ms * 1000));
+    }
+    fprintf(f, "\n");
+  }
+  fclose(f);
+  return true;
+}
+
+static void runSketch(double seconds) {
+  uint64_t endMicros = hostMicros + (uint64_t)(seconds * 1e6);
+  while (hostMicros < endMicros) timedLoop();
+}
+
+// Run each effect in turn through the real loop() by borrowing the first slot of the non-audio list
+static void runSweep(uint32_t frames) {
+  functionList savedEffect = effectListNoAudio[0];
+  boolean savedAudio = audioEnabled;
+  boolean savedCycle = autoCycle;
+
+  for (unsigned i = 0; i < NUM_HOST_EFFECTS; i++) {
+    if (onlyEffect && strcmp(onlyEffect, hostEffects[i].name)) continue;
+    effectListNoAudio[0] = hostEffects[i].effect;
+    audioEnabled = false;
+    autoCycle = false;
+    currentEffect = 0;
+    effectInit = false;
+    audioActive = false;
+    fillAll(CRGB::Black);
+
+#ifdef DETERMINISTIC
+    // start every effect from the same state so one effect's output doesn't depend on another's
+    random16_set_seed(DETERMINISTIC_SEED);
+    loopCount = 0;
+    effectMillis = cycleMillis = hueMillis = audioMillis = 0;
+    cycleHue = 0;
+    for (byte b = 0; b < 7; b++) spectrumDecay[b] = spectrumDecayFine[b] = spectrumPeaks[b] = 0;
+    audioAvg = 300.0;
+    gainAGC = 1.0;
+#endif
+
+    uint32_t rendered = 0;
+    while (rendered < frames) {
+      if (timedLoop()) {
+        rendered++;
+        if (recordHashes) effectHashes[i].push_back(frameHash());
+        if (bakeFile) writeFrame(bakeFile, effectDelay, leds);
+      }
+    }
+  }
+
+  effectListNoAudio[0] = savedEffect;
+  audioEnabled = savedAudio;
+  autoCycle = savedCycle;
+}
+
+#ifdef ADALIGHT
+
+// Start on another effect, so the sketch has to switch to adalight by itself when frames come in
+static void runAdalight(double seconds, double fps) {
+  effectListNoAudio[0] = adalight;
+  audioEnabled = false;
+  numEffects = numEffectsNoAudio;
+  autoCycle = false;
+  currentEffect = 1;
+  effectInit = false;
+  adalightTest = true;
+
+  uint64_t endMicros = hostMicros + (uint64_t)(seconds * 1e6);
+  double nextMicros = hostMicros;
+  uint8_t packet[6 + FRAME_BYTES] = { 'A', 'd', 'a', 0, LAST_VISIBLE_LED, LAST_VISIBLE_LED ^ 0x55 };
+  uint32_t arrived = 0;
+
+  while (hostMicros < endMicros) {
+    if (hostMicros >= nextMicros && adaArrivals.size() < 65536) {
+      adalightPattern(adaArrivals.size(), packet + 6);
+      adaArrivals.push_back(hostSerialInput(packet, sizeof(packet)));
+      nextMicros += 1e6 / fps;
+    }
+    timedLoop();
+  }
+  for (size_t n = 0; n < adaArrivals.size(); n++) {
+    if (adaArrivals[n] <= endMicros) arrived++;
+  }
+
+  printf("adalight at %lu baud: %u frames received in %.1f s (%.1f fps), %u shown intact (%.1f fps), "
+         "%u torn, %u bytes lost\n",
+         Serial.baud, arrived, seconds, arrived / seconds, adaShown, adaShown / seconds, adaTorn, hostSerialLost);
+  if (adaShown) {
+    printf("input to show latency: mean %.0f us, max %llu us\n",
+           (double)adaLatencyTotal / adaShown, (unsigned long long)adaLatencyMax);
+  }
+}
+
+#endif
+
+static void printTimings() {
+  printf("%-20s %8s %10s %12s %8s", "effect", "frames", "fps", "us/frame", "awake");
+  if (referenceFile) printf(" %8s %8s", "maxdiff", "over");
+  printf("\n");
+  for (unsigned i = 0; i < NUM_HOST_EFFECTS; i++) {
+    if (timings[i].frames == 0) continue;
+    double fps = timings[i].virtualMicros ? timings[i].frames * 1e6 / timings[i].virtualMicros : 0;
+    double usPerFrame = timings[i].loopNanos / 1000.0 / timings[i].frames;
+    double awake = timings[i].virtualMicros ? 100.0 - timings[i].sleptMicros * 100.0 / timings[i].virtualMicros : 0;
+    printf("%-20s %8u %10.1f %12.3f %7.1f%%", hostEffects[i].name, timings[i].frames, fps, usPerFrame, awake);
+    if (referenceFile) printf(" %8d %8u", timings[i].maxDifference, timings[i].overTolerance);
+    printf("\n");
+  }
+}
+
+#ifdef DETERMINISTIC
+
+static std::string goldenPath(const char *dir, unsigned i) {
+  return std::string(dir) + "/" + hostEffects[i].name + ".txt";
+}
+
+static bool writeGolden(const char *dir) {
+  for (unsigned i = 0; i < NUM_HOST_EFFECTS; i++) {
+    FILE *f = fopen(goldenPath(dir, i).c_str(), "w");
+    if (!f) {
+      perror(goldenPath(dir, i).c_str());
+      return false;
+    }
+    for (size_t n = 0; n < effectHashes[i].size(); n++) fprintf(f, "%08X\n", effectHashes[i][n]);
+    fclose(f);
+  }
+  printf("wrote %u golden files to %s\n", (unsigned)NUM_HOST_EFFECTS, dir);
+  return true;
+}
+
+static bool checkGolden(const char *dir) {
+  unsigned failures = 0;
+  for (unsigned i = 0; i < NUM_HOST_EFFECTS; i++) {
+    FILE *f = fopen(goldenPath(dir, i).c_str(), "r");
+    if (!f) {
+      printf("%-20s missing golden file\n", hostEffects[i].name);
+      failures++;
+      continue;
+    }
+    unsigned frame = 0;
+    unsigned golden;
+    bool match = true;
+    while (fscanf(f, "%x", &golden) == 1) {
+      if (frame >= effectHashes[i].size() || effectHashes[i][frame] != golden) {
+        match = false;
+        break;
+      }
+      frame++;
+    }
+    if (match && frame != effectHashes[i].size()) match = false;
+    fclose(f);
+
+    if (match) {
+      printf("%-20s ok\n", hostEffects[i].name);
+    } else {
+      printf("%-20s MISMATCH at frame %u\n", hostEffects[i].name, frame);
+      failures++;
+    }
+  }
+  printf("%u of %u effects differ from %s\n", failures, (unsigned)NUM_HOST_EFFECTS, dir);
+  return failures == 0;
+}
+
+#endif
+
+#ifdef TUNING
+
+// beatDetect() keeps its running average in 1/256ths and moves it by 1/16ths
+// of the change times AGCSMOOTH. With a bass level stepping between near
+// silence and the loudest the audio path gives, check it against the same
+// average in doubles at AGCSMOOTHs up to the table's maximum, where a 32-bit
+// product would overflow.
+#define BEATCHECKSTEPS 4000
+static bool checkBeatAverage() {
+  const float smooths[] = {0.004, 0.03, 0.25};
+  bool ok = true;
+  for (byte k = 0; k < sizeof(smooths) / sizeof(smooths[0]); k++) {
+    paramSet(PARAM_AGCSMOOTH, PARAMRAW(smooths[k], PARAMFRACTION_AGCSMOOTH));
+    double smooth = AGCSMOOTH / 65536.0;
+    beatTriggered = 0;
+    lastBeatVal = beatAvg = 0;
+    lastBeatMillis = 0;
+    double expected = 0;
+    long worst = 0;
+    for (int n = 0; n < BEATCHECKSTEPS; n++) {
+      currentMillis = n * (AUDIODELAY + 1);
+      spectrumDecay[0] = spectrumDecay[1] = (n / 200) & 1 ? 4095 : (n % 7) * 20;
+      beatDetect();
+      expected += ((((long)spectrumDecay[0] + spectrumDecay[1]) << 7) - expected) * smooth;
+      long off = labs(beatAvg - lround(expected));
+      if (off > worst) worst = off;
+    }
+    // stepping by 1/16ths it can stop short of the level by 2^16 / AGCSMOOTH
+    long allowed = 65536L / AGCSMOOTH + 32;
+    bool good = worst <= allowed;
+    printf("AGCSMOOTH %.3f: beat average at most %ld/256 off, allowed %ld, %s\n",
+           smooth, worst, allowed, good ? "ok" : "FAIL");
+    if (!good) ok = false;
+  }
+  paramReset();
+  return ok;
+}
+
+#endif
+
+int main(int argc, char **argv) {
+  double seconds = 60;
+  bool secondsGiven = false;
+  std::vector<const char *> wavPaths;
+  float wavGain = 2.0;
+  bool beats = false;
+  const char *beatTimesPath = 0;
+  const char *levelsPath = 0;
+  uint32_t sweepFrames = 0;
+  const char *dumpPath = 0;
+  const char *eepromPath = 0;
+  const char *serialPath = 0;
+  const char *inputPath = 0;
+  const char *referencePath = 0;
+  const char *bakePath = 0;
+#ifdef DETERMINISTIC
+  const char *goldenDir = 0;
+  bool writingGolden = false;
+#endif
+#ifdef ADALIGHT
+  double adalightFps = 0;
+#endif
+#ifdef TUNING
+  bool beatCheck = false;
+#endif
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--seconds") && i + 1 < argc) {
+      seconds = atof(argv[++i]);
+      secondsGiven = true;
+    } else if (!strcmp(argv[i], "--sweep") && i + 1 < argc) {
+      sweepFrames = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--dump") && i + 1 < argc) {
+      dumpPath = argv[++i];
+    } else if (!strcmp(argv[i], "--eeprom") && i + 1 < argc) {
+      eepromPath = argv[++i];
+    } else if (!strcmp(argv[i], "--serial") && i + 1 < argc) {
+      serialPath = argv[++i];
+    } else if (!strcmp(argv[i], "--input") && i + 1 < argc) {
+      inputPath = argv[++i];
+    } else if (!strcmp(argv[i], "--reference") && i + 1 < argc) {
+      referencePath = argv[++i];
+    } else if (!strcmp(argv[i], "--tolerance") && i + 1 < argc) {
+      tolerance = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--effect") && i + 1 < argc) {
+      onlyEffect = argv[++i];
+    } else if (!strcmp(argv[i], "--bake") && i + 1 < argc) {
+      bakePath = argv[++i];
+    } else if (!strcmp(argv[i], "--wav") && i + 1 < argc) {
+      wavPaths.push_back(argv[++i]);
+    } else if (!strcmp(argv[i], "--wav-gain") && i + 1 < argc) {
+      wavGain = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "--beats")) {
+      beats = true;
+    } else if (!strcmp(argv[i], "--beat-times") && i + 1 < argc) {
+      beatTimesPath = argv[++i];
+    } else if (!strcmp(argv[i], "--levels") && i + 1 < argc) {
+      levelsPath = argv[++i];
+    } else if (!strcmp(argv[i], "--blur") && i + 1 < argc) {
+      forceBlur = atoi(argv[++i]) & 0xFF;
+    } else if (!strcmp(argv[i], "--bloom") && i + 1 < argc) {
+      forceBloom = atoi(argv[++i]) & 0xFF;
+#ifdef DETERMINISTIC
+    } else if (!strcmp(argv[i], "--golden") && i + 1 < argc) {
+      goldenDir = argv[++i];
+    } else if (!strcmp(argv[i], "--write-golden") && i + 1 < argc) {
+      goldenDir = argv[++i];
+      writingGolden = true;
+#endif
+#ifdef TUNING
+    } else if (!strcmp(argv[i], "--beat-check")) {
+      beatCheck = true;
+#endif
+#ifdef ADALIGHT
+    } else if (!strcmp(argv[i], "--adalight") && i + 1 < argc) {
+      adalightFps = atof(argv[++i]);
+#endif
+    } else {
+      fprintf(stderr, "usage: %s [--seconds N] [--sweep FRAMES] [--dump FILE] [--eeprom FILE] "
+              "[--serial FILE] [--input FILE] [--reference FILE [--tolerance N]] [--effect NAME] [--bake FILE] "
+              "[--blur N] [--bloom N] [--wav FILE [--wav-gain G] [--beats [--beat-times FILE]] [--levels FILE]]"
+#ifdef DETERMINISTIC
+              " [--golden DIR | --write-golden DIR]"
+#endif
+#ifdef ADALIGHT
+              " [--adalight FPS]"
+#endif
+              "\n", argv[0]);
+      return 2;
+    }
+  }
+
+  if (dumpPath) {
+    dumpFile = fopen(dumpPath, "wb");
+    if (!dumpFile) {
+      perror(dumpPath);
+      return 1;
+    }
+  }
+  if (bakePath) {
+    bakeFile = fopen(bakePath, "wb");
+    if (!bakeFile) {
+      perror(bakePath);
+      return 1;
+    }
+  }
+  if (onlyEffect) {
+    bool found = false;
+    for (unsigned i = 0; i < NUM_HOST_EFFECTS; i++) found |= !strcmp(onlyEffect, hostEffects[i].name);
+    if (!found) {
+      fprintf(stderr, "no effect called %s\n", onlyEffect);
+      return 2;
+    }
+  }
+  if (referencePath) {
+    referenceFile = fopen(referencePath, "rb");
+    if (!referenceFile) {
+      perror(referencePath);
+      return 1;
+    }
+  }
+  FILE *serialFile = 0;
+  if (serialPath) {
+    serialFile = fopen(serialPath, "wb");
+    if (!serialFile) {
+      perror(serialPath);
+      return 1;
+    }
+    hostSetSerialOutput(serialFile);
+  }
+  FastLED.setShowHook(showFrame);
+  if (eepromPath) EEPROM.load(eepromPath);
+#ifdef DETERMINISTIC
+  if (goldenDir) {
+    recordHashes = true;
+    if (!sweepFrames) sweepFrames = GOLDEN_FRAMES;
+  }
+#endif
+
+#ifdef TUNING
+  if (beatCheck) return checkBeatAverage() ? 0 : 1;
+#endif
+  if (beats) {
+    if (wavPaths.empty()) {
+      fprintf(stderr, "--beats needs at least one --wav\n");
+      return 2;
+    }
+    FILE *times = 0;
+    if (beatTimesPath) {
+      times = fopen(beatTimesPath, "w");
+      if (!times) {
+        perror(beatTimesPath);
+        return 1;
+      }
+    }
+    bool ok = runBeats(wavPaths, wavGain, times);
+    if (times) fclose(times);
+    return ok ? 0 : 1;
+  }
+  if (wavPaths.size() > 1) {
+    fprintf(stderr, "only --beats takes more than one --wav\n");
+    return 2;
+  }
+  if (levelsPath && wavPaths.empty()) {
+    fprintf(stderr, "--levels needs a --wav\n");
+    return 2;
+  }
+  if (!wavPaths.empty()) {
+    Msgeq7Audio audio;
+    std::string error;
+    if (!msgeq7LoadWav(wavPaths[0], audio, error)) {
+      fprintf(stderr, "%s: %s\n", wavPaths[0], error.c_str());
+      return 1;
+    }
+    msgeq7Process(audio, wavGain, wavTrack);
+    if (levelsPath) return writeLevels(levelsPath, wavPaths[0]) ? 0 : 1;
+    hostSetSpectrumSource(wavSpectrum);
+    if (!secondsGiven) seconds = wavTrack.millis / 1000.0;
+  }
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  setup();
+  if (inputPath) {
+    FILE *f = fopen(inputPath, "rb");
+    if (!f) {
+      perror(inputPath);
+      return 1;
+    }
+    uint8_t buffer[4096];
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), f)) > 0) hostSerialInput(buffer, length);
+    fclose(f);
+  }
+  if (sweepFrames) {
+    runSweep(sweepFrames);
+#ifdef ADALIGHT
+  } else if (adalightFps > 0) {
+    runAdalight(seconds, adalightFps);
+#endif
+  } else {
+    runSketch(seconds);
+  }
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+  printTimings();
+  double wall = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1e6;
+  printf("%u frames shown, %.1f s virtual in %.3f s wall (%.0fx real time)\n",
+         FastLED.showCount(), hostMicros / 1e6, wall, wall > 0 ? hostMicros / 1e6 / wall : 0);
+  printf("clock error: millis() %+ld ms, frame clock %+ld ms\n",
+         (long)(millis() - hostMicros / 1000), (long)(clockMillis() - hostMicros / 1000));
+
+  int status = 0;
+  if (referenceFile) {
+    printf("%u frames compared with %s, max difference %d, %u over tolerance %d\n",
+           framesCompared, referencePath, maxDifference, framesOverTolerance, tolerance);
+    if (framesOverTolerance) status = 1;
+    fclose(referenceFile);
+  }
+#ifdef DETERMINISTIC
+  if (goldenDir) {
+    bool ok = writingGolden ? writeGolden(goldenDir) : checkGolden(goldenDir);
+    if (!ok) status = 1;
+  }
+#endif
+
+  if (dumpFile) fclose(dumpFile);
+  if (bakeFile) fclose(bakeFile);
+  if (serialFile) fclose(serialFile);
+  if (eepromPath) EEPROM.save(eepromPath);
+  return status;
+}
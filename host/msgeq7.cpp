@@ -0,0 +1,154 @@
+// MSGEQ7 model, see msgeq7.h
+
+#include "msgeq7.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static const float bandCentres[MSGEQ7_BANDS] = {63, 160, 400, 1000, 2500, 6250, 16000};
+
+static uint32_t get16(const uint8_t *p) {
+  return p[0] | (p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+bool msgeq7LoadWav(const char *path, Msgeq7Audio &audio, std::string &error) {
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    error = strerror(errno);
+    return false;
+  }
+  std::vector<uint8_t> data;
+  uint8_t buffer[65536];
+  size_t length;
+  while ((length = fread(buffer, 1, sizeof(buffer), f)) > 0) data.insert(data.end(), buffer, buffer + length);
+  fclose(f);
+
+  if (data.size() < 12 || memcmp(&data[0], "RIFF", 4) || memcmp(&data[8], "WAVE", 4)) {
+    error = "not a WAV file";
+    return false;
+  }
+
+  uint32_t format = 0, channels = 0, bits = 0;
+  const uint8_t *samples = 0;
+  size_t sampleBytes = 0;
+  audio.rate = 0;
+  for (size_t pos = 12; pos + 8 <= data.size();) {
+    const uint8_t *chunk = &data[pos];
+    size_t size = get32(chunk + 4);
+    size_t available = data.size() - pos - 8;
+    if (size > available) size = available; // a truncated file, take what there is
+    if (!memcmp(chunk, "fmt ", 4) && size >= 16) {
+      format = get16(chunk + 8);
+      channels = get16(chunk + 10);
+      audio.rate = get32(chunk + 12);
+      bits = get16(chunk + 22);
+      if (format == 0xFFFE && size >= 26) format = get16(chunk + 32); // WAVE_FORMAT_EXTENSIBLE
+    } else if (!memcmp(chunk, "data", 4)) {
+      samples = chunk + 8;
+      sampleBytes = size;
+    }
+    pos += 8 + size + (size & 1);
+  }
+
+  if (!samples || !channels || !audio.rate) {
+    error = "no fmt or data chunk";
+    return false;
+  }
+  if (!((format == 1 && (bits == 8 || bits == 16 || bits == 24 || bits == 32)) || (format == 3 && bits == 32))) {
+    error = "only 8, 16, 24 and 32-bit PCM and 32-bit float are read";
+    return false;
+  }
+
+  size_t width = bits / 8;
+  size_t frames = sampleBytes / (width * channels);
+  if (!frames) {
+    error = "no samples";
+    return false;
+  }
+  audio.samples.resize(frames);
+  for (size_t i = 0; i < frames; i++) {
+    float sum = 0;
+    for (uint32_t c = 0; c < channels; c++) {
+      const uint8_t *p = samples + (i * channels + c) * width;
+      if (format == 3) {
+        uint32_t raw = get32(p);
+        float value;
+        memcpy(&value, &raw, sizeof(value));
+        sum += value;
+      } else if (bits == 8) {
+        sum += (p[0] - 128) / 128.0f;
+      } else if (bits == 16) {
+        sum += (int16_t)get16(p) / 32768.0f;
+      } else if (bits == 24) {
+        sum += (int32_t)((p[0] << 8) | (p[1] << 16) | ((uint32_t)p[2] << 24)) / 2147483648.0f;
+      } else {
+        sum += (int32_t)get32(p) / 2147483648.0f;
+      }
+    }
+    audio.samples[i] = sum / channels;
+  }
+  return true;
+}
+
+void msgeq7Process(const Msgeq7Audio &audio, float gain, Msgeq7Track &track) {
+  // band-pass, 0 dB at the centre (RBJ cookbook), b1 = 0 and b2 = -b0
+  float b0[MSGEQ7_LANES], a1[MSGEQ7_LANES], a2[MSGEQ7_LANES];
+  float y1[MSGEQ7_LANES], y2[MSGEQ7_LANES], peak[MSGEQ7_LANES];
+  float release = expf(-1000.0f / (MSGEQ7_RELEASE_MS * audio.rate));
+  for (int k = 0; k < MSGEQ7_LANES; k++) {
+    float centre = k < MSGEQ7_BANDS ? bandCentres[k] : 1000;
+    if (centre > audio.rate * 0.45f) centre = audio.rate * 0.45f; // 16k at low sample rates
+    float w = 2 * (float)M_PI * centre / audio.rate;
+    float alpha = sinf(w) / (2 * MSGEQ7_Q);
+    float a0 = 1 + alpha;
+    b0[k] = alpha / a0;
+    a1[k] = -2 * cosf(w) / a0;
+    a2[k] = (1 - alpha) / a0;
+    y1[k] = y2[k] = peak[k] = 0;
+  }
+
+  size_t count = audio.samples.size();
+  track.millis = (uint32_t)((uint64_t)count * 1000 / audio.rate);
+  track.levels.assign((size_t)track.millis * MSGEQ7_BANDS, MSGEQ7_OFFSET);
+
+  float x1 = 0, x2 = 0;
+  uint32_t ms = 0;
+  uint64_t nextMs = audio.rate / 1000; // sample at which the next millisecond starts, rounded down
+  const float *in = audio.samples.data();
+  for (size_t i = 0; i < count; i++) {
+    float x = in[i] * gain;
+    float dx = x - x2;
+    for (int k = 0; k < MSGEQ7_LANES; k++) {
+      float y = b0[k] * dx - a1[k] * y1[k] - a2[k] * y2[k];
+      y2[k] = y1[k];
+      y1[k] = y;
+      float level = fabsf(y);
+      float held = peak[k] * release;
+      peak[k] = level > held ? level : held;
+    }
+    x2 = x1;
+    x1 = x;
+
+    if (i + 1 >= nextMs && ms < track.millis) {
+      uint16_t *out = &track.levels[(size_t)ms * MSGEQ7_BANDS];
+      for (int k = 0; k < MSGEQ7_BANDS; k++) {
+        float counts = MSGEQ7_OFFSET + peak[k] * MSGEQ7_FULLSCALE;
+        out[k] = counts > 1023 ? 1023 : (uint16_t)counts;
+      }
+      ms++;
+      nextMs = (uint64_t)(ms + 1) * audio.rate / 1000;
+    }
+  }
+}
+
+uint16_t msgeq7Level(const Msgeq7Track &track, uint8_t band, uint64_t micros) {
+  uint64_t ms = micros / 1000;
+  if (ms >= track.millis || band >= MSGEQ7_BANDS) return MSGEQ7_OFFSET;
+  return track.levels[ms * MSGEQ7_BANDS + band];
+}
@@ -0,0 +1,50 @@
+// MSGEQ7 model for the host builds: drives the audio input from WAV files
+//
+// The chip splits its input into seven bands centred on 63, 160, 400, 1k,
+// 2.5k, 6.25k and 16k Hz, follows the peak of each and puts them out as DC
+// levels. Here each band is a biquad band-pass filter followed by a peak
+// follower, run over the whole file up front. The levels are kept every
+// millisecond in ADC counts, with the chip's DC offset at silence and a
+// full-scale sine in a band reaching MSGEQ7_FULLSCALE. The sketch then reads
+// them through analogRead() at its own AUDIODELAY cadence, like the board.
+//
+// The seven filters are run side by side over eight float lanes (the eighth
+// idle), with no branches and no dependency between lanes, so the compiler
+// turns each step into a few vector instructions.
+
+#ifndef HOST_MSGEQ7_H
+#define HOST_MSGEQ7_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#define MSGEQ7_BANDS 7
+#define MSGEQ7_LANES 8
+#define MSGEQ7_OFFSET 60      // ADC counts at silence, under the sketch's NOISEFLOOR
+#define MSGEQ7_FULLSCALE 1000 // counts for a full-scale sine at a band's centre
+#define MSGEQ7_Q 1.4f         // width of the bands
+#define MSGEQ7_RELEASE_MS 20.0f
+
+struct Msgeq7Audio {
+  std::vector<float> samples; // mono, -1 to 1
+  uint32_t rate;
+};
+
+// Levels every millisecond, levels[ms * MSGEQ7_BANDS + band]
+struct Msgeq7Track {
+  std::vector<uint16_t> levels;
+  uint32_t millis;
+};
+
+// Read a PCM (8, 16, 24 or 32-bit) or 32-bit float WAV file, mixed down to
+// mono. False with a reason in error if it can't.
+bool msgeq7LoadWav(const char *path, Msgeq7Audio &audio, std::string &error);
+
+// Run the filters over the audio, gain scales the input first
+void msgeq7Process(const Msgeq7Audio &audio, float gain, Msgeq7Track &track);
+
+// A band's level at a time from the start of the track, silence past its end
+uint16_t msgeq7Level(const Msgeq7Track &track, uint8_t band, uint64_t micros);
+
+#endif
@@ -0,0 +1,128 @@
+// Layers
+//
+// A composite effect runs a base effect into leds[] as usual, then one or
+// more overlay effects, each drawn into layer[] and blended into leds[] in a
+// single pass. layer[] holds a palette index per LED into layerPalette, with
+// 0 meaning transparent, so it takes 80 bytes where a second frame of CRGB
+// would take 240.
+//
+// Overlays draw into layer[] with XY() like effects do into leds[]. They set
+// layerPalette (and audioActive if they need it) when effectInit is false,
+// but leave effectInit, effectDelay and fadeActive to the base effect.
+// The blend goes into leds[], so the base has to draw every LED each frame
+// (plasma, threeSine, audioPlasma...) rather than fade or scroll what was
+// there.
+
+#define BLENDADD 0      // under + over, clipped
+#define BLENDSCREEN 1   // brightens like add, but never clips
+#define BLENDMULTIPLY 2 // darkens, over acts as a filter
+#define BLENDALPHA 3    // over on top, layerAlpha of the way
+#define BLENDMAX 4      // the brighter of the two per channel
+#define NUMBLENDS 5
+
+struct Layer {
+  functionList draw;
+  byte blend;
+};
+
+byte layer[NUM_LEDS];
+CRGBPalette16 layerPalette;
+byte layerAlpha = 128;
+
+inline byte blendScreen(byte a, byte b) {
+  return a + scale8(b, 255 - a);
+}
+
+inline byte blendAlpha(byte a, byte b) {
+  return scale8(a, 255 - layerAlpha) + scale8(b, layerAlpha);
+}
+
+inline byte blendMax(byte a, byte b) {
+  return a > b ? a : b;
+}
+
+#define BLENDLOOP(op) \
+  for (byte i = 0; i <= LAST_VISIBLE_LED; i++) { \
+    if (!layer[i]) continue; \
+    CRGB over = ColorFromPalette(layerPalette, layer[i]); \
+    leds[i].r = op(leds[i].r, over.r); \
+    leds[i].g = op(leds[i].g, over.g); \
+    leds[i].b = op(leds[i].b, over.b); \
+  }
+
+// Blend layer[] into leds[]
+void layerBlend(byte mode) {
+  switch (mode) {
+    case BLENDADD: BLENDLOOP(qadd8); break;
+    case BLENDSCREEN: BLENDLOOP(blendScreen); break;
+    case BLENDMULTIPLY: BLENDLOOP(scale8); break;
+    case BLENDALPHA: BLENDLOOP(blendAlpha); break;
+    case BLENDMAX: BLENDLOOP(blendMax); break;
+  }
+}
+
+// Run a base effect, then each overlay blended on top
+void composite(functionList base, const Layer *layers, byte count) {
+  boolean init = effectInit;
+  base();
+  for (byte i = 0; i < count; i++) {
+    effectInit = init;
+    memset(layer, 0, sizeof(layer));
+    layers[i].draw();
+    layerBlend(layers[i].blend);
+  }
+  effectInit = true;
+}
+
+
+// Overlays
+
+// VU meter from both sides like drawVU(), fading in from black
+void overlayVU() {
+  if (effectInit == false) {
+    layerPalette = HeatColors_p;
+    audioActive = true;
+  }
+
+  // in 1/256ths, as in drawVU()
+  const long xScale = 255L * 256 / (kMatrixWidth / 2);
+  long specCombo = ((long)spectrumDecay[0] + spectrumDecay[1] + spectrumDecay[2] + spectrumDecay[3]) *
+                   PARAMRECIPROCAL(VUScaleFactor, 10) >> 4;
+
+  for (byte x = 0; x < kMatrixWidth / 2; x++) {
+    int level = (specCombo - xScale * x) * VUFadeFactor / 256;
+    byte index = constrain(level, 0, 255);
+    for (byte y = 0; y < kMatrixHeight; y++) {
+      layer[XY(x, y)] = index;
+      layer[XY(kMatrixWidth - x - 1, y)] = index;
+    }
+  }
+}
+
+
+#ifdef BENCHMARK
+// Time layerBlend() in each mode with every LED covered, as BENCH_BLEND + mode
+void layerBench() {
+  layerPalette = RainbowColors_p;
+  for (byte i = 0; i < NUM_LEDS; i++) {
+    layer[i] = i * 3 + 1;
+    leds[i] = CHSV(i * 5, 255, 255);
+  }
+  for (byte mode = 0; mode < NUMBLENDS; mode++) {
+    GPIOR1 = BENCH_BLEND | mode;
+    for (uint16_t i = 0; i < BENCH_FRAMES; i++) {
+      STAGE_BEGIN(STAGE_EFFECT);
+      layerBlend(mode);
+      STAGE_END(STAGE_EFFECT);
+    }
+  }
+}
+#endif
+
+
+// Composite effects, used in the effect lists like any other
+
+const Layer plasmaVULayers[] = {{overlayVU, BLENDSCREEN}};
+void plasmaVU() {
+  composite(plasma, plasmaVULayers, 1);
+}
@@ -0,0 +1,100 @@
+// RAM monitoring
+//
+// At power up, all RAM between the end of the static variables and the top
+// of the stack is painted with a canary byte. The stack only grows down into
+// it, so the canary bytes still untouched above the static variables are the
+// least free RAM the sketch has ever had.
+//
+// RAM_* give the static RAM used by each part of the sketch, at compile time.
+// The RAM of effects left out of the effect lists (HISTORYEFFECTS and the like
+// in RGBShadesAudio.ino) only counts when they are in, as only then it is linked.
+// Function-local statics inside effects are not included; tools/ramreport.py
+// gives the exact per-symbol breakdown from the compiled firmware.
+
+#define STACKCANARY 0xC5
+
+#define RAM_LEDS (sizeof(leds))
+#define RAM_PALETTES (sizeof(currentPalette) + RAM_PALETTECACHE)
+#define RAM_AUDIO (sizeof(spectrumValue) + sizeof(spectrumDecay) + sizeof(spectrumDecayFine) + sizeof(spectrumPeaks) + \
+                   sizeof(audioAvg) + sizeof(gainAGC) + sizeof(beatTriggered) + sizeof(lastBeatVal) + \
+                   sizeof(beatAvg) + sizeof(lastBeatMillis) + RAM_HISTORY)
+#ifdef HISTORYEFFECTS
+#define RAM_HISTORY (sizeof(spectrumHistory) + sizeof(historyHead) + sizeof(historyLoudest) + \
+                     sizeof(historySum) + sizeof(historySquares) + sizeof(historyMillis))
+#else
+#define RAM_HISTORY 0 // not linked without waterfall
+#endif
+#ifdef VM
+#define RAM_VM (sizeof(vmCode) + sizeof(vmLoaded) + sizeof(vmPixelStart) + sizeof(vmRegs) + sizeof(vmFrames) + \
+                sizeof(vmUploadSlot) + sizeof(vmUploadLength) + sizeof(vmUploadNibble) + sizeof(vmUploadData))
+#else
+#define RAM_VM 0
+#endif
+#define RAM_EFFECTS (sizeof(noise) + sizeof(scale) + sizeof(nx) + sizeof(ny) + sizeof(nz) + sizeof(nspeed) + \
+                     sizeof(charBuffer) + sizeof(currentStringAddress) + \
+                     RAM_LAYERS + RAM_PARTICLES + \
+                     sizeof(blurAmount) + sizeof(bloomAmount) + sizeof(bloomThreshold) + RAM_VM)
+#ifdef LAYEREFFECTS
+#define RAM_LAYERS (sizeof(layer) + sizeof(layerPalette) + sizeof(layerAlpha))
+#else
+#define RAM_LAYERS 0 // not linked without plasmaVU
+#endif
+#ifdef PARTICLEEFFECTS
+#define RAM_PARTICLES (sizeof(particles) + sizeof(particleNext))
+#else
+#define RAM_PARTICLES 0 // not linked without fireflies or beatSparks
+#endif
+#define RAM_BUTTONS (sizeof(buttonEdges) + sizeof(buttonRaw) + sizeof(buttonRawTime) + sizeof(buttonDown) + \
+                     sizeof(buttonStatuses) + sizeof(buttonStateTime) + sizeof(buttonEventQueue) + \
+                     sizeof(notifySaved))
+
+#ifdef __AVR__
+
+extern uint8_t __heap_start;
+extern void *__brkval;
+
+// Runs before main() and before the static variables are initialized
+void paintStack() __attribute__((naked, used, section(".init3")));
+void paintStack() {
+  __asm volatile (
+    "    ldi r30, lo8(__heap_start)\n"
+    "    ldi r31, hi8(__heap_start)\n"
+    "    ldi r24, %0\n"
+    "    ldi r25, hi8(__stack)\n"
+    "1:  st Z+, r24\n"
+    "    cpi r30, lo8(__stack)\n"
+    "    cpc r31, r25\n"
+    "    brlo 1b\n"
+    "    breq 1b\n"
+    : : "i" (STACKCANARY) : "r24", "r25", "r30", "r31", "memory");
+}
+
+// Bytes between the heap (or the static variables) and the stack right now
+uint16_t freeRam() {
+  uint8_t *heapEnd = __brkval ? (uint8_t *)__brkval : &__heap_start;
+  return (uint8_t *)SP - heapEnd;
+}
+
+// Lowest free RAM since power up: canary bytes the stack hasn't reached yet
+uint16_t minFreeRam() {
+  const uint8_t *p = __brkval ? (const uint8_t *)__brkval : &__heap_start;
+  uint16_t count = 0;
+  while (*p == STACKCANARY && p <= (const uint8_t *)SP) {
+    p++;
+    count++;
+  }
+  return count;
+}
+
+#else
+
+// no stack to watch on the host
+uint16_t freeRam() {
+  return 0;
+}
+
+uint16_t minFreeRam() {
+  return 0;
+}
+
+#endif
@@ -0,0 +1,91 @@
+// Notifications
+//
+// Feedback for the buttons (audio mode, auto cycle, brightness) shown over
+// the running effect without stopping loop(). A notification is a small icon
+// in the middle of each lens, blinking or fading out in its color. The effect
+// keeps drawing into leds[]; at show time the icon is blended into the frame,
+// shown, and the few pixels under it put back, so the effect carries on with
+// its own frame. Only the pixels under the icon are saved (NOTIFYPIXELS, 36
+// bytes) rather than a copy of the frame (204). Audio, buttons and EEPROM
+// keep running too.
+
+#define NOTIFYNONE 0
+#define NOTIFYBLINK 1 // on and off count times
+#define NOTIFYFLASH 2 // on once, then fade out
+
+#define NOTIFYSTEP 200 // ms on and ms off per blink, fade out time per flash
+
+// Icons, 3x3 with bit (row * 3 + column) set for a lit pixel
+#define NOTIFYAUDIO 0 // rising bars
+#define NOTIFYAUTO 1 // a tick
+#define NOTIFYMANUAL 2 // a cross
+#define NOTIFYBRIGHTNESS 3 // a plus
+const uint16_t notifyIcons[] PROGMEM = {0x1F4, 0x0AC, 0x155, 0x0BA};
+
+#define NOTIFYICONX 2 // top left of the icon in the left lens
+#define NOTIFYICONY 1
+#define NOTIFYLENS 9 // and how far across the right lens's is
+#define NOTIFYPIXELS 12 // lit pixels in the biggest icon, both lenses
+
+CRGB notifyColor;
+byte notifyPattern = NOTIFYNONE;
+byte notifyIcon;
+byte notifyCount;
+unsigned long notifyMillis;
+CRGB notifySaved[NOTIFYPIXELS];
+
+// Start a notification, replacing any still running (count is for blinks)
+void notify(CRGB color, byte icon, byte pattern, byte count) {
+  notifyColor = color;
+  notifyIcon = icon;
+  notifyPattern = pattern;
+  notifyCount = count;
+  notifyMillis = currentMillis;
+}
+
+// Blend the icon into leds[] by amount, saving what was under it, or put
+// back what was saved
+void notifyPixels(byte amount, boolean restore) {
+  uint16_t icon = pgm_read_word(&notifyIcons[notifyIcon]);
+  byte n = 0;
+  for (byte bit = 0; bit < 9; bit++) {
+    if (!(icon & (1 << bit))) continue;
+    for (byte lens = 0; lens < 2; lens++) {
+      byte i = XY(NOTIFYICONX + bit % 3 + lens * NOTIFYLENS, NOTIFYICONY + bit / 3);
+      if (restore) {
+        leds[i] = notifySaved[n++];
+      } else {
+        notifySaved[n++] = leds[i];
+        nblend(leds[i], notifyColor, amount);
+      }
+    }
+  }
+}
+
+// Blend the notification into leds[] for this show, false if there is none
+// to draw. notifyRestore() puts the effect's pixels back after the show.
+boolean notifyDraw() {
+  if (notifyPattern == NOTIFYNONE) return false;
+
+  unsigned long elapsed = currentMillis - notifyMillis;
+  unsigned long step = elapsed / NOTIFYSTEP;
+  byte amount = 255;
+
+  // a blink is count on and off steps, a flash one on and one fading step
+  if (step >= (notifyPattern == NOTIFYBLINK ? notifyCount * 2 : 2)) {
+    notifyPattern = NOTIFYNONE;
+    return false;
+  }
+
+  if (step & 1) {
+    if (notifyPattern == NOTIFYBLINK) return false; // off, just the effect
+    amount = 255 - (elapsed - NOTIFYSTEP) * 255 / NOTIFYSTEP;
+  }
+
+  notifyPixels(amount, false);
+  return true;
+}
+
+void notifyRestore() {
+  notifyPixels(0, true);
+}
@@ -0,0 +1,138 @@
+// Tuning parameters
+//
+// The audio and timing constants that most often need adjusting. Each one is
+// a variable named like the old #define, held as unsigned 16-bit fixed point:
+// value * 2^fraction bits. The whole numbers (fraction 0) are used as they
+// are; the others only through PARAMFIXED() and PARAMRECIPROCAL(), which
+// turn them into the fixed point an effect wants with integer math.
+// Normally they are const and fold to constants at compile time; with TUNING
+// they live in RAM and can be changed over Serial (see serial.h) without
+// reflashing, and saved to EEPROM.
+
+//      name                 default  min     max      fraction bits
+#define PARAMTABLE(X) \
+      X(SPECTRUMSMOOTH,      0.1,     0.0,    1.0,     15) \
+      X(PEAKDECAY,           0.05,    0.0,    1.0,     15) \
+      X(NOISEFLOOR,          65,      0,      1023,    0)  \
+      X(AGCSMOOTH,           0.004,   0.0,    0.25,    16) \
+      X(beatLevel,           25.0,    0.0,    255.0,   8)  \
+      X(beatDeadzone,        35.0,    0.0,    255.0,   8)  \
+      X(analyzerScaleFactor, 1.5,     0.1,    31.0,    11) \
+      X(VUScaleFactor,       2.0,     0.1,    31.0,    11) \
+      X(cycleTime,           15000,   1000,   60000,   0)  \
+      X(hueTime,             30,      1,      1000,    0)
+
+#define PARAMRAW(value, fraction) ((uint16_t)((value) * (1L << (fraction)) + 0.5))
+
+#define PARAMID(name, def, lo, hi, fraction) PARAM_##name,
+enum { PARAMTABLE(PARAMID) NUMPARAMS };
+
+#define PARAMFRACTIONS(name, def, lo, hi, fraction) PARAMFRACTION_##name = fraction,
+enum { PARAMTABLE(PARAMFRACTIONS) };
+
+// A parameter as fixed point for the effects, rounded: value * 2^fraction,
+// or 2^fraction / value (fraction + the parameter's own up to 30)
+#define PARAMFIXED(name, fraction) \
+  ((long)((((unsigned long)(name) << (fraction)) + (1UL << PARAMFRACTION_##name >> 1)) >> PARAMFRACTION_##name))
+#define PARAMRECIPROCAL(name, fraction) \
+  ((long)(((1UL << ((fraction) + PARAMFRACTION_##name)) + (name) / 2) / (name)))
+
+#ifdef TUNING
+#define PARAMVARIABLE(name, def, lo, hi, fraction) uint16_t name = PARAMRAW(def, fraction);
+#else
+#define PARAMVARIABLE(name, def, lo, hi, fraction) const uint16_t name = PARAMRAW(def, fraction);
+#endif
+PARAMTABLE(PARAMVARIABLE)
+
+#ifdef TUNING
+
+// Address of the saved parameters: NUMPARAMS, the raw values, then their sum
+#define PARAMEEPROM 16
+
+struct ParamInfo {
+  const char *name;
+  uint16_t minimum;
+  uint16_t maximum;
+  uint16_t standard;
+  byte fraction;
+};
+
+#define PARAMNAME(name, def, lo, hi, fraction) const char paramName_##name[] PROGMEM = #name;
+PARAMTABLE(PARAMNAME)
+
+#define PARAMINFO(name, def, lo, hi, fraction) \
+  {paramName_##name, PARAMRAW(lo, fraction), PARAMRAW(hi, fraction), PARAMRAW(def, fraction), fraction},
+const ParamInfo paramInfo[NUMPARAMS] PROGMEM = { PARAMTABLE(PARAMINFO) };
+
+uint16_t paramMinimum(byte id) {
+  return pgm_read_word(&paramInfo[id].minimum);
+}
+
+uint16_t paramMaximum(byte id) {
+  return pgm_read_word(&paramInfo[id].maximum);
+}
+
+uint16_t paramDefault(byte id) {
+  return pgm_read_word(&paramInfo[id].standard);
+}
+
+byte paramFraction(byte id) {
+  return pgm_read_byte(&paramInfo[id].fraction);
+}
+
+const char *paramName(byte id) {
+  return (const char *)pgm_read_word(&paramInfo[id].name);
+}
+
+// Current value of a parameter in fixed point
+uint16_t paramGet(byte id) {
+  switch (id) {
+#define PARAMGET(name, def, lo, hi, fraction) \
+    case PARAM_##name: return name;
+    PARAMTABLE(PARAMGET)
+  }
+  return 0;
+}
+
+// Set a parameter from fixed point, limited to its range
+void paramSet(byte id, uint16_t raw) {
+  if (id >= NUMPARAMS) return;
+  raw = constrain(raw, paramMinimum(id), paramMaximum(id));
+  switch (id) {
+#define PARAMSET(name, def, lo, hi, fraction) \
+    case PARAM_##name: name = raw; break;
+    PARAMTABLE(PARAMSET)
+  }
+}
+
+void paramReset() {
+#define PARAMRESET(name, def, lo, hi, fraction) name = PARAMRAW(def, fraction);
+  PARAMTABLE(PARAMRESET)
+}
+
+void paramSave() {
+  settingsFlush(); // EEPROM.write() and the settings interrupt mustn't overlap
+  byte sum = NUMPARAMS;
+  updateEEPROM(PARAMEEPROM, NUMPARAMS);
+  for (byte i = 0; i < NUMPARAMS; i++) {
+    uint16_t raw = paramGet(i);
+    updateEEPROM(PARAMEEPROM + 1 + i * 2, raw & 0xFF);
+    updateEEPROM(PARAMEEPROM + 2 + i * 2, raw >> 8);
+    sum += (raw & 0xFF) + (raw >> 8);
+  }
+  updateEEPROM(PARAMEEPROM + 1 + NUMPARAMS * 2, sum);
+}
+
+// Load saved parameters, if they were saved by a build with the same table
+void paramLoad() {
+  if (EEPROM.read(PARAMEEPROM) != NUMPARAMS) return;
+  byte sum = NUMPARAMS;
+  for (byte i = 0; i < NUMPARAMS * 2; i++) sum += EEPROM.read(PARAMEEPROM + 1 + i);
+  if (EEPROM.read(PARAMEEPROM + 1 + NUMPARAMS * 2) != sum) return;
+
+  for (byte i = 0; i < NUMPARAMS; i++) {
+    paramSet(i, EEPROM.read(PARAMEEPROM + 1 + i * 2) | EEPROM.read(PARAMEEPROM + 2 + i * 2) << 8);
+  }
+}
+
+#endif
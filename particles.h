@@ -0,0 +1,199 @@
+// Particles
+//
+// A fixed pool of PARTICLES particles for effects to emit into. Positions
+// are 8.8 fixed point pixels, velocities 1/64 pixel per frame, so a particle
+// can be anywhere between LEDs and move slower than a pixel a frame. Each
+// frame particleUpdate() moves them, adds particleGravity to their vertical
+// speed and takes particleDecay off their life, which is also their
+// brightness. Particles that run out of life or leave the shades are freed.
+// particleRender() adds them to leds[], either on the nearest LED or, when
+// smooth, spread over the four LEDs around them by how close they are.
+//
+// 8 bytes a particle, 256 bytes for the pool.
+
+#define PARTICLES 32
+
+struct Particle {
+  int16_t x;  // 8.8 pixels
+  int16_t y;
+  int8_t vx;  // 1/64 pixel per frame
+  int8_t vy;
+  byte life;  // 0 = free
+  byte color; // index into currentPalette, through paletteColor()
+};
+
+Particle particles[PARTICLES];
+byte particleNext = 0;       // where to look for a free particle first
+int8_t particleGravity = 0;  // added to vy every frame
+byte particleDecay = 4;      // taken off life every frame
+
+#define PARTICLEMAXX ((int16_t)kMatrixWidth << 8)
+#define PARTICLEMAXY ((int16_t)kMatrixHeight << 8)
+
+void particleClear() {
+  for (byte i = 0; i < PARTICLES; i++) particles[i].life = 0;
+}
+
+// Start a particle, false if the pool is full
+boolean particleEmit(int16_t x, int16_t y, int8_t vx, int8_t vy, byte color, byte life) {
+  for (byte n = 0; n < PARTICLES; n++) {
+    Particle &p = particles[particleNext];
+    if (++particleNext >= PARTICLES) particleNext = 0;
+    if (p.life) continue;
+    p.x = x;
+    p.y = y;
+    p.vx = vx;
+    p.vy = vy;
+    p.color = color;
+    p.life = life;
+    return true;
+  }
+  return false;
+}
+
+void particleUpdate() {
+  for (Particle *p = particles; p < particles + PARTICLES; p++) {
+    if (!p->life) continue;
+    p->x += p->vx * 4;
+    p->y += p->vy * 4;
+    if (p->vy < 127 - particleGravity) p->vy += particleGravity;
+    // a particle half a pixel off the edge still lights the edge when smooth
+    if (p->x <= -256 || p->x >= PARTICLEMAXX || p->y <= -256 || p->y >= PARTICLEMAXY || p->life <= particleDecay) {
+      p->life = 0;
+    } else {
+      p->life -= particleDecay;
+    }
+  }
+}
+
+inline void particleAdd(int8_t x, int8_t y, CRGB color, byte scale) {
+  if (x < 0 || x >= kMatrixWidth || y < 0 || y >= kMatrixHeight || !scale) return;
+  leds[XY(x, y)] += color.nscale8(scale);
+}
+
+void particleRender(boolean smooth) {
+  for (Particle *p = particles; p < particles + PARTICLES; p++) {
+    if (!p->life) continue;
+    CRGB color = paletteColor(p->color, p->life);
+    if (!smooth) {
+      particleAdd((p->x + 128) >> 8, (p->y + 128) >> 8, color, 255);
+      continue;
+    }
+    int8_t x = p->x >> 8;
+    int8_t y = p->y >> 8;
+    byte fx = p->x & 0xFF;
+    byte fy = p->y & 0xFF;
+    particleAdd(x, y, color, scale8(255 - fx, 255 - fy));
+    particleAdd(x + 1, y, color, scale8(fx, 255 - fy));
+    particleAdd(x, y + 1, color, scale8(255 - fx, fy));
+    particleAdd(x + 1, y + 1, color, scale8(fx, fy));
+  }
+}
+
+
+// Emitters
+
+// Count particles at random places, drifting slowly in random directions
+void emitScatter(byte count, byte life) {
+  while (count--) {
+    particleEmit(random16(PARTICLEMAXX), random16(PARTICLEMAXY), random8(33) - 16, random8(33) - 16, random8(), life);
+  }
+}
+
+// Count particles flying out from x, y in all directions at up to speed (127 at most)
+void emitBurst(int16_t x, int16_t y, byte count, byte speed, byte color, byte life) {
+  byte angle = random8();
+  for (byte i = 0; i < count; i++) {
+    angle += 256 / count + random8(16);
+    byte v = random8(speed / 2, speed);
+    int8_t vx = scale8(cos8(angle), v) - v / 2;
+    int8_t vy = scale8(sin8(angle), v) - v / 2;
+    particleEmit(x, y, vx * 2, vy * 2, color + random8(32), life);
+  }
+}
+
+
+// A sudden rise in the bass, for emitters that follow the music. Quicker to
+// come back than beatDetect(), which waits for the level to fall far enough.
+#define ONSETRISE 60  // rise in the two smoothed bass bands (added) from one frame to the next
+#define ONSETHOLD 150 // ms before another onset counts
+boolean bassOnset() {
+  static uint16_t lastBass = 0;
+  static unsigned long onsetMillis = 0;
+  uint16_t bass = spectrumDecay[0] + spectrumDecay[1];
+  boolean onset = bass > lastBass + ONSETRISE && currentMillis - onsetMillis > ONSETHOLD;
+  if (onset) onsetMillis = currentMillis;
+  lastBass = bass;
+  return onset;
+}
+
+
+#ifdef BENCHMARK
+// Time particleUpdate() and particleRender() with every particle alive, as
+// BENCH_PARTICLES + 0 (update), 1 (render) and 2 (smooth render)
+void particleBench() {
+  particleGravity = 0;
+  particleDecay = 0;
+  for (byte i = 0; i < PARTICLES; i++) {
+    particleEmit(random16(PARTICLEMAXX), random16(PARTICLEMAXY), 0, 0, random8(), 255);
+  }
+  for (byte step = 0; step < 3; step++) {
+    GPIOR1 = BENCH_PARTICLES | step;
+    for (uint16_t i = 0; i < BENCH_FRAMES; i++) {
+      STAGE_BEGIN(STAGE_EFFECT);
+      if (step == 0) particleUpdate();
+      else particleRender(step == 2);
+      STAGE_END(STAGE_EFFECT);
+    }
+  }
+  particleClear();
+}
+#endif
+
+
+// Particle effects
+
+// Glowing dots that fade in place as they drift, a particle take on confetti
+void fireflies() {
+
+  // startup tasks
+  if (effectInit == false) {
+    effectInit = true;
+    effectDelay = 10;
+    selectRandomPalette();
+    fadeActive = 0;
+    particleClear();
+    particleGravity = 0;
+    particleDecay = 3;
+  }
+
+  emitScatter(1, 255);
+  particleUpdate();
+  fillAll(CRGB::Black);
+  particleRender(true);
+
+}
+
+// Sparks burst from a random spot on every kick and fall away
+void beatSparks() {
+
+  // startup tasks
+  if (effectInit == false) {
+    effectInit = true;
+    effectDelay = 10;
+    selectRandomAudioPalette();
+    audioActive = true;
+    fadeActive = 0;
+    particleClear();
+    particleGravity = 1;
+    particleDecay = 4;
+  }
+
+  if (bassOnset()) {
+    emitBurst(random16(PARTICLEMAXX), random16(PARTICLEMAXY / 2), 16, 64, random8(), 255);
+  }
+  particleUpdate();
+  fillAll(CRGB::Black);
+  particleRender(true);
+
+}
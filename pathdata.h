@@ -0,0 +1,40 @@
+// LED paths for paths.h, generated from the layout in XYmap.h by tools/paths.py
+// Rerun it (tools/paths.py > pathdata.h) if the layout changes.
+
+struct Path {
+  const byte *leds;
+  byte length;
+};
+
+#define PATHOUTLINE 0
+#define PATHLEFTRIM 1
+#define PATHRIGHTRIM 2
+#define PATHROW0 3
+#define PATHROW1 4
+#define PATHROW2 5
+#define PATHROW3 6
+#define PATHROW4 7
+#define NUMPATHS 8
+
+const byte pathOutline[] PROGMEM = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 43, 44, 67, 66, 65, 64, 63, 50, 37, 21, 22, 36, 51, 62, 61, 60, 59, 58, 57, 30, 29};
+const byte pathLeftRim[] PROGMEM = {0, 1, 2, 3, 4, 5, 6, 22, 36, 51, 62, 61, 60, 59, 58, 57, 30, 29};
+const byte pathRightRim[] PROGMEM = {7, 8, 9, 10, 11, 12, 13, 14, 43, 44, 67, 66, 65, 64, 63, 50, 37, 21};
+const byte pathRow0[] PROGMEM = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13};
+const byte pathRow1[] PROGMEM = {29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17, 16, 15, 14};
+const byte pathRow2[] PROGMEM = {30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43};
+const byte pathRow3[] PROGMEM = {57, 56, 55, 54, 53, 52, 51, 50, 49, 48, 47, 46, 45, 44};
+const byte pathRow4[] PROGMEM = {58, 59, 60, 61, 62, 63, 64, 65, 66, 67};
+
+const Path pathTable[NUMPATHS] PROGMEM = {
+  {pathOutline, 36},
+  {pathLeftRim, 18},
+  {pathRightRim, 18},
+  {pathRow0, 14},
+  {pathRow1, 16},
+  {pathRow2, 14},
+  {pathRow3, 14},
+  {pathRow4, 10},
+};
+
+const byte blurRows[] PROGMEM = {14, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 16, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17, 16, 15, 14, 7, 30, 31, 32, 33, 34, 35, 36, 7, 37, 38, 39, 40, 41, 42, 43, 7, 57, 56, 55, 54, 53, 52, 51, 7, 50, 49, 48, 47, 46, 45, 44, 5, 58, 59, 60, 61, 62, 5, 63, 64, 65, 66, 67, 0}; // 68 LEDs
+const byte blurColumns[] PROGMEM = {3, 29, 30, 57, 5, 0, 28, 31, 56, 58, 5, 1, 27, 32, 55, 59, 5, 2, 26, 33, 54, 60, 5, 3, 25, 34, 53, 61, 5, 4, 24, 35, 52, 62, 4, 5, 23, 36, 51, 2, 6, 22, 2, 7, 21, 4, 8, 20, 37, 50, 5, 9, 19, 38, 49, 63, 5, 10, 18, 39, 48, 64, 5, 11, 17, 40, 47, 65, 5, 12, 16, 41, 46, 66, 5, 13, 15, 42, 45, 67, 3, 14, 43, 44, 0}; // 68 LEDs
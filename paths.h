@@ -0,0 +1,125 @@
+// Paths
+//
+// Effects that run along a line of LEDs, the outline or a row, draw on the
+// paths in pathdata.h, which tools/paths.py generates from the layout. They
+// live in flash. Positions along a path are 8.8 fixed point LEDs, so a comet
+// can sit between two LEDs and move slower than one a frame. Its head is
+// spread over the two LEDs around it by how close it is to each, and the
+// tail fades by a fixed step an LED. The inner loops only add, subtract and
+// compare; the one division, for the tail's step, is once a comet.
+
+inline byte pathLength(byte path) {
+  return pgm_read_byte(&pathTable[path].length);
+}
+
+inline const byte *pathLeds(byte path) {
+  return (const byte *)pgm_read_word(&pathTable[path].leds);
+}
+
+// The LED at step i along a path
+inline byte pathLed(byte path, byte i) {
+  return pgm_read_byte(pathLeds(path) + i);
+}
+
+// Move a position along a path by speed (8.8, less than the path's length
+// either way), coming round again at the ends
+uint16_t pathMove(byte path, uint16_t pos, int16_t speed) {
+  uint16_t end = pathLength(path) << 8;
+  pos += speed;
+  if (pos >= end) {
+    if (speed < 0) pos += end; // went below 0
+    else pos -= end;
+  }
+  return pos;
+}
+
+inline void pathAdd(const byte *leds8, byte i, CRGB color, byte scale) {
+  leds[pgm_read_byte(leds8 + i)] += color.nscale8(scale);
+}
+
+// A comet with its head at pos, fading out over tail LEDs behind it (towards
+// the start of the path), added to what's there. A tail of 1 is just the
+// head, an antialiased dot. With wrap the ends of the path join up, so the
+// tail carries on from the far end; without, it stops at the start.
+void drawComet(byte path, uint16_t pos, byte tail, CRGB color, boolean wrap) {
+  const byte *p = pathLeds(path);
+  byte length = pathLength(path);
+  if (tail > length) tail = length;
+  if (!tail) return;
+  byte i = pos >> 8;
+  byte frac = pos & 0xFF;
+  byte fade = 255 / tail;
+
+  // the part of the head that has moved on into the next LED
+  byte ahead = i + 1;
+  if (ahead >= length) ahead = wrap ? 0 : 255;
+  if (ahead != 255 && frac) pathAdd(p, ahead, color, frac);
+
+  byte bright = 255 - scale8(frac, fade);
+  for (byte n = 0; n < tail && bright; n++) {
+    pathAdd(p, i, color, bright);
+    bright = qsub8(bright, fade);
+    if (i == 0) {
+      if (!wrap) return;
+      i = length;
+    }
+    i--;
+  }
+}
+
+// A solid stretch from start to start + size (both 8.8) along a path, its
+// ends spread over the LEDs they fall between, like a comet's head
+void drawSegment(byte path, uint16_t start, uint16_t size, CRGB color, boolean wrap) {
+  const byte *p = pathLeds(path);
+  byte length = pathLength(path);
+  byte i = start >> 8;
+  uint16_t from = start & 0xFF; // where it starts and ends, counted from LED i
+  uint16_t to = from + size;
+  while (to > from) {
+    uint16_t upto = to > 256 ? 256 : to;
+    pathAdd(p, i, color, upto - from > 255 ? 255 : upto - from);
+    if (to <= 256) return;
+    to -= 256;
+    from = 0;
+    if (++i >= length) {
+      if (!wrap) return;
+      i = 0;
+    }
+  }
+}
+
+
+// Path effects
+
+// Two comets chasing round the outline and one round each lens, the lenses
+// mirrored, gliding between LEDs rather than stepping. Bloom makes the heads glow.
+#define COMETS 4
+#define COMETTAIL 6
+const byte cometPaths[COMETS] PROGMEM = {PATHOUTLINE, PATHOUTLINE, PATHLEFTRIM, PATHRIGHTRIM};
+const int16_t cometSpeeds[COMETS] PROGMEM = {80, -56, 96, -96};
+
+void comets() {
+  static uint16_t pos[COMETS];
+
+  // startup tasks
+  if (effectInit == false) {
+    effectInit = true;
+    effectDelay = 10;
+    selectRandomPalette();
+    fadeActive = 0;
+    bloomAmount = 96;
+    bloomThreshold = 160;
+    pos[0] = 0;
+    pos[1] = (pathLength(PATHOUTLINE) / 2) << 8;
+    pos[2] = 0;
+    pos[3] = 6 << 8; // the right lens's top right, mirroring the left's top left
+  }
+
+  fillAll(CRGB::Black);
+  for (byte k = 0; k < COMETS; k++) {
+    byte path = pgm_read_byte(&cometPaths[k]);
+    pos[k] = pathMove(path, pos[k], (int16_t)pgm_read_word(&cometSpeeds[k]));
+    drawComet(path, pos[k], COMETTAIL, paletteColor(cycleHue + k * 64), true);
+  }
+
+}
@@ -0,0 +1,120 @@
+// Power saving
+//
+// POWERSAVE: loop() only shows a frame when something changed (an effect
+// frame, a fade, a notification or the brightness), and between those puts
+// the CPU in idle sleep until the next thing is due: an effect frame, audio
+// sample, hue step, auto cycle, settings save or button timeout. Timer0 wakes
+// it every millisecond to check, and a button edge or a Serial byte ends the
+// sleep early. Effects that fade every pass and running notifications keep
+// loop() spinning as before.
+//
+// In the audio sets the shades also dim to STANDBYDIM after SILENCETIME of
+// silence, and come back on sound or any button.
+//
+// idleMicros counts the time spent asleep, for the duty cycle the host
+// runner reports per effect.
+
+#define SILENCELEVEL 4     // audioAvg below this is silence, twice this is sound again
+#define SILENCETIME 30000  // ms of silence before dimming
+#define STANDBYDIM 32      // brightness in standby, out of 255 of the normal
+
+boolean standby = false;
+byte standbyBrightness;      // brightness to go back to
+unsigned long silenceMillis; // when there was last sound or a button press
+
+// Back to full brightness, and start timing the silence again
+void standbyEnd() {
+  silenceMillis = currentMillis;
+  if (!standby) return;
+  standby = false;
+  FastLED.setBrightness(standbyBrightness);
+}
+
+// Look at the audio level after each sample
+void checkSilence() {
+  if (audioAvg > SILENCELEVEL * 2) {
+    standbyEnd();
+  } else if (audioAvg > SILENCELEVEL) {
+    if (!standby) silenceMillis = currentMillis;
+  } else if (!standby && currentMillis - silenceMillis > SILENCETIME) {
+    standby = true;
+    standbyBrightness = FastLED.getBrightness();
+    FastLED.setBrightness(scale8(standbyBrightness, STANDBYDIM));
+  }
+}
+
+#if defined(POWERSAVE) && !defined(DETERMINISTIC)
+
+#ifdef __AVR__
+#include <avr/sleep.h>
+#endif
+
+uint32_t idleMicros = 0;
+byte shownBrightness = 0;
+
+// Whether this pass of loop() has to show a frame
+boolean powerShow(boolean effectRan) {
+  if (effectRan || fadeActive || notifyPattern != NOTIFYNONE || FastLED.getBrightness() != shownBrightness) {
+    shownBrightness = FastLED.getBrightness();
+    return true;
+  }
+  return false;
+}
+
+// Move wake up to when a timer last reset at start runs out, if that's sooner
+void powerDue(unsigned long &wake, unsigned long start, unsigned long wait) {
+  if ((long)(start + wait + 1 - wake) < 0) wake = start + wait + 1;
+}
+
+// only look at Serial when something reads it, or HardwareSerial and its
+// buffers get linked in for nothing
+#ifdef SERIALCOMMANDS
+#define powerSerialWaiting() Serial.available()
+#else
+#define powerSerialWaiting() false
+#endif
+
+// Sleep until the next thing loop() has to do
+void powerSleep() {
+  if (fadeActive || notifyPattern != NOTIFYNONE || settingsPending) return;
+#ifdef STREAMING
+  if (streamSent < streamLength) return;
+#endif
+  for (byte i = 0; i < NUMBUTTONS; i++) {
+    if (buttonStatuses[i] != BTNIDLE || buttonRaw[i] != buttonDown[i]) return; // timing a press
+  }
+
+  unsigned long wake = effectMillis + effectDelay + 1;
+  powerDue(wake, hueMillis, hueTime);
+  if (audioActive) powerDue(wake, audioMillis, AUDIODELAY);
+  if (autoCycle && !showPlaying()) powerDue(wake, cycleMillis, cycleTime);
+  if (eepromOutdated) powerDue(wake, eepromMillis, EEPROMDELAY);
+#ifdef SHOW
+  if (showPlaying() && (long)(showMillis - wake) < 0) wake = showMillis;
+#endif
+
+  unsigned long start = micros();
+#ifdef __AVR__
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  // an edge or byte coming in just before sleep_mode() waits for the next tick
+  while ((long)(clockMillis() - wake) < 0 && buttonEdgeTail == buttonEdgeHead && !powerSerialWaiting()) {
+    sleep_mode();
+  }
+#else
+  // wake on each millisecond tick like timer0 does, looking for button edges
+  // in place of the pin change interrupt
+  while ((long)(clockMillis() - wake) < 0 && buttonEdgeTail == buttonEdgeHead && !powerSerialWaiting()) {
+    hostAdvance(1000 - hostMicros % 1000);
+    buttonEdge();
+  }
+#endif
+  idleMicros += micros() - start;
+}
+
+#else
+
+#define powerShow(effectRan) true
+#define powerSleep()
+#define idleMicros 0UL
+
+#endif
@@ -0,0 +1,187 @@
+// Serial command interface
+//
+// Single-character commands sent to the shades at SERIALBAUD, some followed
+// by decimal numbers and a newline.
+// Only compiled in when a feature that talks over Serial is enabled.
+//
+//   p  send the loop stage histograms (PROFILING)
+//   m  send free RAM (RAMMONITOR) as
+//      M,<free now>,<lowest free>,<leds>,<palettes>,<audio>,<effects>,<buttons>
+//      where the last five are static RAM in bytes per part of the sketch
+//   s  pause or resume frame streaming (STREAMING)
+//   c  play the show from the start, right away (SHOW)
+//   q  stop the show (SHOW)
+//   u<slot>,<hex>  write a bytecode effect to an EEPROM slot (VM), replies
+//      U,<slot>,<length>; tools/vmasm.py assembles and sends it
+//
+// Parameters in params.h (TUNING), values in their fixed point:
+//   l              list all parameters
+//   g<id>          get one, both reply with lines of
+//                  P,<id>,<name>,<value>,<min>,<max>,<default>,<fraction bits>
+//   t<id>,<value>  set one (limited to its range), replies like g
+//   r              back to the defaults in flash
+//   w              save to EEPROM, replies W when done
+// tools/tune.py does the fixed point conversion.
+//
+// FastLED.show() blocks interrupts for about 2 ms, long enough for all but
+// two bytes of a burst to be lost. After any byte comes in, loop() stops
+// showing for SERIALQUIET, so a host should send a newline, wait a few
+// milliseconds, then send its command.
+//
+// With ADALIGHT, Adalight frames (see adalight.h) can be sent at any time
+// in between commands.
+
+#ifndef SERIALBAUD
+#define SERIALBAUD 115200
+#endif
+
+#if defined(PROFILING) || defined(RAMMONITOR) || defined(STREAMING) || defined(ADALIGHT) || defined(TUNING) || \
+    defined(SHOW) || defined(VM)
+#define SERIALCOMMANDS
+#endif
+
+#ifdef SERIALCOMMANDS
+
+#define SERIALQUIET 100
+
+unsigned long serialMillis = 0; // when the last byte came in
+
+// loop() leaves show() alone for a while after the host sends something
+boolean serialHoldShow() {
+  return currentMillis - serialMillis <= SERIALQUIET;
+}
+
+#ifdef RAMMONITOR
+void sendRamReport() {
+  const uint16_t report[] = {freeRam(), minFreeRam(), RAM_LEDS, RAM_PALETTES, RAM_AUDIO, RAM_EFFECTS, RAM_BUTTONS};
+  Serial.print('M');
+  for (byte i = 0; i < sizeof(report) / sizeof(report[0]); i++) {
+    Serial.print(',');
+    Serial.print(report[i]);
+  }
+  Serial.println();
+}
+#endif
+
+#if defined(TUNING) || defined(VM)
+char serialPending = 0; // command still reading its numbers
+#endif
+
+#ifdef TUNING
+byte serialArgCount = 0;
+uint16_t serialArgs[2];
+
+void sendParam(byte id) {
+  const uint16_t fields[] = {paramGet(id), paramMinimum(id), paramMaximum(id), paramDefault(id), paramFraction(id)};
+  Serial.print('P');
+  Serial.print(',');
+  Serial.print(id);
+  Serial.print(',');
+  const char *name = paramName(id);
+  while (char c = pgm_read_byte(name++)) Serial.print(c);
+  for (byte i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+    Serial.print(',');
+    Serial.print(fields[i]);
+  }
+  Serial.println();
+}
+
+// Collect the numbers after g or t, run the command at the end of the line
+void paramCommandByte(byte data) {
+  if (data >= '0' && data <= '9') {
+    serialArgs[serialArgCount] = serialArgs[serialArgCount] * 10 + (data - '0');
+    return;
+  }
+  if (data == ',' && serialArgCount == 0) {
+    serialArgCount++;
+    return;
+  }
+
+  if (serialArgs[0] < NUMPARAMS) {
+    if (serialPending == 't' && serialArgCount == 1) paramSet(serialArgs[0], serialArgs[1]);
+    sendParam(serialArgs[0]);
+  }
+  serialPending = 0;
+}
+#endif
+
+// Handle any pending commands
+void doSerial() {
+  while (Serial.available()) {
+    byte command = Serial.read();
+    serialMillis = currentMillis;
+#ifdef ADALIGHT
+    if (adalightByte(command)) continue;
+#endif
+#ifdef VM
+    if (serialPending == 'u') {
+      if (vmUploadByte(command)) serialPending = 0;
+      continue;
+    }
+#endif
+#ifdef TUNING
+    if (serialPending) {
+      paramCommandByte(command);
+      continue;
+    }
+#endif
+
+    switch (command) {
+#ifdef PROFILING
+      case 'p':
+        profileDump();
+        break;
+#endif
+#ifdef RAMMONITOR
+      case 'm':
+        sendRamReport();
+        break;
+#endif
+#ifdef STREAMING
+      case 's':
+        streamEnabled = !streamEnabled;
+        break;
+#endif
+#ifdef SHOW
+      case 'c':
+        showStart();
+        serialMillis = currentMillis - SERIALQUIET - 1; // a lone start byte shouldn't hold the first frames
+        break;
+      case 'q':
+        showStop();
+        break;
+#endif
+#ifdef VM
+      case 'u':
+        serialPending = command;
+        vmUploadBegin();
+        break;
+#endif
+#ifdef TUNING
+      case 'l':
+        for (byte i = 0; i < NUMPARAMS; i++) sendParam(i);
+        break;
+      case 'g':
+      case 't':
+        serialPending = command;
+        serialArgCount = 0;
+        serialArgs[0] = serialArgs[1] = 0;
+        break;
+      case 'r':
+        paramReset();
+        break;
+      case 'w':
+        paramSave();
+        Serial.println('W');
+        break;
+#endif
+    }
+  }
+}
+
+#else
+
+#define doSerial()
+#define serialHoldShow() false
+
+#endif
@@ -0,0 +1,146 @@
+// Settings storage in EEPROM
+//
+// Effect, auto-cycle, brightness and audio mode are saved as 8-byte records
+// in a ring of SETTINGSSLOTS slots, each save going into the slot after the
+// last one, so every slot gets a fraction of the writes. A record is
+//   sequence, version, effect, autoCycle, brightness, audioEnabled, 0, CRC-8
+// and at power up the valid record with the newest sequence number wins.
+// A record cut short by a power loss fails its CRC and the one before it is
+// used instead.
+//
+// Saving doesn't block: the EEPROM ready interrupt writes one byte each time
+// the EEPROM finishes the last one (3.3 ms apiece).
+//
+// Settings from before the ring (99 at address 0, then the four values) are
+// loaded if there is no record yet and saved to the ring.
+//
+// The ring ends at SETTINGSEND. Records a build from before the bytecode
+// effects left above it are ignored, so shades updated from one may come up
+// once with the settings of a slightly older save.
+
+#define SETTINGSVERSION 1
+#define SETTINGSSIZE 8
+#define SETTINGSSTART 64 // below are the old settings and the tuning parameters
+#define SETTINGSEND 768  // above are the bytecode effects (vm.h)
+#define SETTINGSSLOTS ((SETTINGSEND - SETTINGSSTART) / SETTINGSSIZE)
+
+byte settingsRecord[SETTINGSSIZE]; // last record loaded or written
+byte settingsSlot = SETTINGSSLOTS; // where it is, SETTINGSSLOTS if nowhere yet
+volatile byte settingsPending = 0; // bytes of settingsRecord still to write
+
+// CRC-8 as in _crc_ibutton_update(), carrying on from crc
+byte crc8(const byte *data, byte length, byte crc = 0) {
+  while (length--) {
+    crc ^= *data++;
+    for (byte i = 0; i < 8; i++) crc = (crc & 1) ? (crc >> 1) ^ 0x8C : crc >> 1;
+  }
+  return crc;
+}
+
+uint16_t settingsAddress(byte slot) {
+  return SETTINGSSTART + slot * SETTINGSSIZE;
+}
+
+#ifdef __AVR__
+
+ISR(EE_READY_vect) {
+  byte i = SETTINGSSIZE - settingsPending;
+  EEAR = settingsAddress(settingsSlot) + i;
+  EEDR = settingsRecord[i];
+  EECR |= _BV(EEMPE);
+  EECR |= _BV(EEPE);
+  if (--settingsPending == 0) EECR &= ~_BV(EERIE);
+}
+
+void settingsStartWrite() {
+  settingsPending = SETTINGSSIZE;
+  EECR |= _BV(EERIE);
+}
+
+boolean settingsBusy() {
+  return settingsPending || (EECR & _BV(EEPE));
+}
+
+void settingsPump() {
+  // the interrupt does it
+}
+
+// Wait for a record being written to be finished
+void settingsFlush() {
+  while (settingsBusy());
+}
+
+#else
+
+// no interrupts on the host: write a byte whenever the EEPROM is ready, from loop()
+void settingsPump() {
+  if (settingsPending && EEPROM.ready()) {
+    EEPROM.writeBackground(settingsAddress(settingsSlot) + SETTINGSSIZE - settingsPending, settingsRecord[SETTINGSSIZE - settingsPending]);
+    settingsPending--;
+  }
+}
+
+void settingsStartWrite() {
+  settingsPending = SETTINGSSIZE;
+  settingsPump();
+}
+
+boolean settingsBusy() {
+  settingsPump();
+  return settingsPending || !EEPROM.ready();
+}
+
+void settingsFlush() {
+  while (settingsPending) {
+    if (!EEPROM.ready()) hostMicros = EEPROM.busyUntil;
+    settingsPump();
+  }
+}
+
+#endif
+
+// Load the newest valid record, or the old settings format
+void loadSettings() {
+  byte record[SETTINGSSIZE];
+
+  for (byte slot = 0; slot < SETTINGSSLOTS; slot++) {
+    for (byte i = 0; i < SETTINGSSIZE; i++) record[i] = EEPROM.read(settingsAddress(slot) + i);
+    if (record[1] != SETTINGSVERSION || crc8(record, SETTINGSSIZE - 1) != record[SETTINGSSIZE - 1]) continue;
+    if (settingsSlot == SETTINGSSLOTS || (int8_t)(record[0] - settingsRecord[0]) > 0) {
+      memcpy(settingsRecord, record, SETTINGSSIZE);
+      settingsSlot = slot;
+    }
+  }
+
+  if (settingsSlot != SETTINGSSLOTS) {
+    currentEffect = settingsRecord[2];
+    autoCycle = settingsRecord[3];
+    currentBrightness = settingsRecord[4];
+    audioEnabled = settingsRecord[5];
+  } else if (EEPROM.read(0) == 99) {
+    currentEffect = EEPROM.read(1);
+    autoCycle = EEPROM.read(2);
+    currentBrightness = EEPROM.read(3);
+    audioEnabled = EEPROM.read(4);
+    eepromOutdated = true; // move them to the ring
+  }
+}
+
+// Write settings to EEPROM if necessary
+void checkEEPROM() {
+  settingsPump();
+  if (eepromOutdated && currentMillis - eepromMillis > EEPROMDELAY && !settingsBusy()) {
+    eepromOutdated = false;
+
+    byte record[SETTINGSSIZE] = {(byte)(settingsRecord[0] + 1), SETTINGSVERSION,
+                                 currentEffect, autoCycle, currentBrightness, audioEnabled, 0, 0};
+    record[SETTINGSSIZE - 1] = crc8(record, SETTINGSSIZE - 1);
+
+    // nothing changed since the last record
+    if (settingsSlot != SETTINGSSLOTS && !memcmp(record + 1, settingsRecord + 1, SETTINGSSIZE - 2)) return;
+
+    memcpy(settingsRecord, record, SETTINGSSIZE);
+    if (++settingsSlot >= SETTINGSSLOTS) settingsSlot = 0;
+    settingsStartWrite();
+  }
+}
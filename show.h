@@ -0,0 +1,117 @@
+// Scripted shows: a cue list in flash played against the frame clock
+//
+// tools/show.py works out the beats, tempo and sections of a song ahead of
+// time and writes showdata.h, a list of cues: switch effect, palette,
+// brightness or hue, or a beat. Once started, the cues play at their times
+// from the start, and the show's beats stand in for beatDetect()'s. Nothing
+// of the song has to be analysed on the shades, and the non-audio effects a
+// show normally uses don't read the MSGEQ7 at all.
+//
+// Start (or restart) the show with a double-click of SW2, or 'c' on Serial
+// (see serial.h). Pressing SW1 or both buttons, or 'q', stops it. Auto cycle
+// is held off while it plays, and the last effect stays on when it ends, at
+// the brightness from before the show.
+//
+// Each cue is a little-endian word, the type in the top 3 bits and the ms
+// since the cue before in the low 13, then a value byte for the types that
+// have one. A gap over CUEMAXGAP ms takes CUEWAIT cues. Only the next cue's
+// due time is looked at each pass of loop().
+
+#define CUEWAIT 0       // nothing, to bridge a long gap
+#define CUEBEAT 1       // a beat for beatDetect()
+#define CUEEFFECT 2     // value: effect list index, plus 128 for the audio list
+#define CUEPALETTE 3    // value: selectPalette(), also used by selectRandomPalette()
+#define CUEBRIGHTNESS 4 // value: brightness out of 255 of MAXBRIGHTNESS
+#define CUEHUE 5        // value: cycleHue
+#define CUEEND 7
+
+#define CUETYPESHIFT 13
+#define CUEMAXGAP 8191
+
+#ifdef SHOW
+
+#include "showdata.h"
+
+extern const byte numEffectsAudio;
+extern const byte numEffectsNoAudio;
+
+const byte *showCue = 0;    // the next cue, 0 when no show is playing
+unsigned long showMillis;   // when it is due
+byte showBrightness;        // to go back to after the show
+
+boolean showPlaying() {
+  return showCue != 0;
+}
+
+// byte by byte, the cues aren't aligned
+uint16_t showWord() {
+  return pgm_read_byte(showCue) | (pgm_read_byte(showCue + 1) << 8);
+}
+
+void showStart() {
+  if (!showCue) showBrightness = FastLED.getBrightness();
+  showCue = showCues;
+  showMillis = currentMillis + (showWord() & CUEMAXGAP);
+  showBeats = 0;
+  showPalette = SHOWNOPALETTE;
+}
+
+void showStop() {
+  if (!showCue) return;
+  showCue = 0;
+  showBeats = SHOWNOBEATS;
+  showPalette = SHOWNOPALETTE;
+  FastLED.setBrightness(showBrightness);
+  cycleMillis = currentMillis; // a whole cycle on the last effect before auto cycle goes on
+}
+
+void showEffect(byte value) {
+  audioEnabled = value & 0x80;
+  numEffects = audioEnabled ? numEffectsAudio : numEffectsNoAudio;
+  currentEffect = value & 0x7F;
+  if (currentEffect >= numEffects) currentEffect = 0;
+  effectInit = false;
+  audioActive = false;
+}
+
+// Play the cues that are due
+void showUpdate() {
+  while (showCue && (long)(currentMillis - showMillis) >= 0) {
+    byte type = showWord() >> CUETYPESHIFT;
+    byte value = 0;
+    showCue += 2;
+    if (type != CUEWAIT && type != CUEBEAT && type != CUEEND) value = pgm_read_byte(showCue++);
+
+    switch (type) {
+      case CUEBEAT:
+        showBeats = 1; // beats closer than a frame count once
+        break;
+      case CUEEFFECT:
+        showEffect(value);
+        break;
+      case CUEPALETTE:
+        showPalette = value;
+        selectPalette(value);
+        break;
+      case CUEBRIGHTNESS:
+        FastLED.setBrightness(scale8(value, MAXBRIGHTNESS));
+        break;
+      case CUEHUE:
+        cycleHue = value;
+        break;
+      case CUEEND:
+        showStop();
+        return;
+    }
+    showMillis += showWord() & CUEMAXGAP;
+  }
+}
+
+#else
+
+#define showPlaying() false
+#define showUpdate() ((void)0)
+#define showStart() ((void)0)
+#define showStop() ((void)0)
+
+#endif
@@ -0,0 +1,30 @@
+// Show cue list for show.h
+//
+// Written by tools/show.py, e.g. tools/show.py song.wav -o showdata.h
+// Recompile rather than edit.
+
+// show-test.wav: 1:03, 127.8 BPM, 136 beats, 3 sections, 149 cues
+// shadesOutline, threeSine, plasma
+// 310 bytes of flash
+const byte showCues[] PROGMEM = {
+  0, 64, 0, 0, 96, 0, 0, 128, 165, 0, 160, 0, 10, 32, 204, 33,
+  214, 33, 214, 33, 214, 33, 214, 33, 214, 33, 214, 33, 214, 33, 204, 33,
+  214, 33, 214, 33, 214, 33, 214, 33, 214, 33, 214, 33, 214, 33, 204, 33,
+  214, 33, 214, 33, 214, 33, 214, 33, 214, 33, 214, 33, 214, 33, 204, 33,
+  214, 33, 214, 33, 214, 33, 214, 33, 214, 33, 214, 33, 214, 65, 1, 0,
+  96, 1, 0, 128, 181, 0, 160, 96, 0, 32, 204, 33, 214, 33, 214, 33,
+  214, 33, 214, 33, 214, 33, 214, 33, 214, 33, 204, 33, 214, 33, 214, 33,
+  214, 33, 214, 33, 214, 33, 214, 33, 214, 33, 204, 33, 214, 33, 214, 33,
+  214, 33, 214, 33, 214, 33, 214, 33, 214, 33, 204, 33, 214, 33, 214, 33,
+  214, 33, 214, 33, 214, 33, 214, 33, 214, 33, 204, 33, 214, 33, 214, 33,
+  214, 33, 214, 33, 214, 33, 214, 33, 214, 33, 204, 33, 214, 33, 214, 33,
+  214, 33, 214, 33, 214, 33, 214, 33, 214, 33, 204, 33, 214, 33, 214, 33,
+  214, 33, 214, 33, 214, 33, 214, 33, 214, 33, 204, 33, 214, 33, 214, 33,
+  214, 33, 214, 33, 214, 33, 214, 33, 204, 65, 2, 0, 96, 2, 0, 128,
+  255, 0, 160, 192, 0, 32, 244, 33, 214, 33, 164, 33, 214, 33, 244, 33,
+  244, 33, 214, 33, 164, 33, 244, 33, 244, 33, 214, 33, 164, 33, 214, 33,
+  244, 33, 244, 33, 144, 33, 204, 33, 214, 33, 214, 33, 214, 33, 214, 33,
+  214, 33, 214, 33, 214, 33, 204, 33, 214, 33, 214, 33, 214, 33, 214, 33,
+  214, 33, 214, 33, 214, 33, 204, 33, 214, 33, 214, 33, 214, 33, 214, 33,
+  214, 33, 214, 33, 204, 225,
+};
@@ -0,0 +1,173 @@
+// Live frame streaming to a host
+//
+// After each FastLED.show() the visible LEDs are sent on Serial as a COBS
+// framed packet ending in a zero byte. Sending never waits for the UART:
+// each pass of loop() only writes what fits in the transmit buffer, and
+// frames shown while a packet is still going out are skipped.
+//
+// Packet contents before COBS encoding, multi-byte values little-endian:
+//   'F', frame(2), 68 x RGB, checksum                    full frame
+//   'D', frame(2), changed(9), RGB per changed LED, checksum
+//                                                        delta (STREAMDELTA)
+//   'S', sent(2), skipped(2), overhead(2), checksum      statistics
+// frame counts every FastLED.show(), so gaps show skipped frames. In a delta
+// packet, bit n of changed (LSB first) marks LED n as sent; the other LEDs
+// are unchanged since the previous packet. Every STREAMKEYFRAME packets a
+// full frame is sent anyway. Statistics go out every STREAMSTATS frames:
+// packets sent and frames skipped since the last statistics, and the
+// average microseconds per frame spent on streaming. checksum is the sum of
+// the preceding bytes.
+//
+// tools/shadesview.py receives and draws the frames.
+
+#ifdef STREAMING
+
+#define STREAMLEDS (LAST_VISIBLE_LED + 1)
+#define STREAMKEYFRAME 32
+#define STREAMSTATS 64
+#define STREAMPAYLOAD (3 + (STREAMLEDS + 7) / 8 + STREAMLEDS * 3 + 1)
+#define STREAMPACKET (STREAMPAYLOAD + STREAMPAYLOAD / 254 + 2)
+
+boolean streamEnabled = true;
+byte streamPacket[STREAMPACKET]; // encoded packet waiting to go out
+uint16_t streamLength = 0;
+uint16_t streamSent = 0;
+
+uint16_t streamFrame = 0;       // frames shown
+uint16_t streamPackets = 0;     // since the last statistics
+uint16_t streamSkipped = 0;
+unsigned long streamMicros = 0;
+byte streamStatsFrames = 0;
+
+#ifdef STREAMDELTA
+CRGB streamPrevious[STREAMLEDS]; // what the host has now
+byte streamSinceKey = STREAMKEYFRAME;
+#endif
+
+// COBS encoder writing into streamPacket
+uint16_t cobsCodeIndex;
+byte cobsCode;
+byte streamChecksum;
+
+void cobsStart() {
+  streamLength = 1;
+  streamSent = 0;
+  cobsCodeIndex = 0;
+  cobsCode = 1;
+  streamChecksum = 0;
+}
+
+void cobsPut(byte data) {
+  streamChecksum += data;
+  if (data != 0) {
+    streamPacket[streamLength++] = data;
+    cobsCode++;
+  }
+  if (data == 0 || cobsCode == 0xFF) {
+    streamPacket[cobsCodeIndex] = cobsCode;
+    cobsCodeIndex = streamLength++;
+    cobsCode = 1;
+  }
+}
+
+void cobsFinish() {
+  cobsPut(streamChecksum);
+  streamPacket[cobsCodeIndex] = cobsCode;
+  streamPacket[streamLength++] = 0;
+}
+
+void cobsPutWord(uint16_t data) {
+  cobsPut(data & 0xFF);
+  cobsPut(data >> 8);
+}
+
+void streamStats() {
+  cobsStart();
+  cobsPut('S');
+  cobsPutWord(streamPackets);
+  cobsPutWord(streamSkipped);
+  cobsPutWord(streamMicros / STREAMSTATS);
+  cobsFinish();
+  streamPackets = 0;
+  streamSkipped = 0;
+  streamMicros = 0;
+}
+
+void streamLeds() {
+  cobsStart();
+
+#ifdef STREAMDELTA
+  if (++streamSinceKey < STREAMKEYFRAME) {
+    cobsPut('D');
+    cobsPutWord(streamFrame);
+
+    byte changed = 0;
+    for (byte i = 0; i < STREAMLEDS; i++) {
+      if (leds[i] != streamPrevious[i]) changed |= 1 << (i & 7);
+      if ((i & 7) == 7 || i == STREAMLEDS - 1) {
+        cobsPut(changed);
+        changed = 0;
+      }
+    }
+    for (byte i = 0; i < STREAMLEDS; i++) {
+      if (leds[i] == streamPrevious[i]) continue;
+      streamPrevious[i] = leds[i];
+      cobsPut(leds[i].r);
+      cobsPut(leds[i].g);
+      cobsPut(leds[i].b);
+    }
+
+    cobsFinish();
+    return;
+  }
+  streamSinceKey = 0;
+  memcpy(streamPrevious, leds, sizeof(streamPrevious));
+#endif
+
+  cobsPut('F');
+  cobsPutWord(streamFrame);
+  for (byte i = 0; i < STREAMLEDS; i++) {
+    cobsPut(leds[i].r);
+    cobsPut(leds[i].g);
+    cobsPut(leds[i].b);
+  }
+  cobsFinish();
+}
+
+// Write as much of the current packet as the transmit buffer takes
+void streamPump() {
+  int room = Serial.availableForWrite();
+  while (room-- > 0 && streamSent < streamLength) {
+    Serial.write(streamPacket[streamSent++]);
+  }
+}
+
+// Call after every FastLED.show()
+void streamShow() {
+  streamFrame++;
+  if (!streamEnabled) return;
+
+  unsigned long startMicros = micros();
+
+  if (streamSent < streamLength) {
+    streamSkipped++; // the UART is still busy with an earlier packet
+  } else if (streamStatsFrames >= STREAMSTATS) {
+    streamStats();
+    streamStatsFrames = 0;
+    streamSkipped++;
+  } else {
+    streamLeds();
+    streamPackets++;
+  }
+  streamStatsFrames++;
+
+  streamPump();
+  streamMicros += micros() - startMicros;
+}
+
+#else
+
+#define streamShow()
+#define streamPump()
+
+#endif
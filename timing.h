@@ -0,0 +1,175 @@
+// Loop stage instrumentation
+//
+// STAGE_BEGIN()/STAGE_END() bracket the work done in each pass of loop().
+// They compile to nothing unless one of the instrumentation modes is enabled.
+//
+// BENCHMARK: cycle-accurate benchmark under simavr (see bench/)
+//   Each stage boundary is a single write to GPIOR0, which the simulator
+//   timestamps with the cycle counter. GPIOR1 holds the running effect.
+//   The sketch then runs every effect of both lists for BENCH_FRAMES
+//   frames and halts. Before that, the layer blends, particles, palette
+//   lookups, spectrum history, post-processing and bytecode programs are
+//   timed on their own as pseudo effects from BENCH_BLEND to BENCH_VM, by
+//   layerBench() and the like next to each of them.
+//
+// PROFILING: stage timing histograms in the field
+//   Each stage is timed with micros() into 16 log2 buckets of one byte,
+//   bucket 0 = 0 us, bucket n = 2^(n-1) to 2^n - 1 us, bucket 15 = 16 ms and up.
+//   When a bucket fills, the whole stage histogram is halved so the shape
+//   is kept. Histograms belong to the running effect and are sent on Serial
+//   when the effect changes (and on the 'p' command), then cleared.
+//   One CSV line per stage that ran: H,<effect>,<stage>,<count0>,...,<count15>
+//   where effect is the list index plus 128 for the audio list.
+//   tools/stagehist.py turns these into per-effect percentiles.
+
+#define STAGE_UPDATEBUTTONS 0
+#define STAGE_DOBUTTONS 1
+#define STAGE_EEPROM 2
+#define STAGE_ANALOGS 3
+#define STAGE_EFFECT 4
+#define STAGE_FADE 5
+#define STAGE_SHOW 6
+#define STAGE_POST 7
+#define NUMSTAGES 8
+
+// Included before the headers it times, so these come from further on
+extern boolean effectInit;
+extern byte currentEffect;
+extern boolean autoCycle;
+extern boolean audioEnabled;
+extern boolean audioActive;
+extern byte numEffects;
+extern const byte numEffectsAudio;
+extern const byte numEffectsNoAudio;
+void fillAll(CRGB fillColor);
+
+#ifdef BENCHMARK
+
+#include <avr/sleep.h>
+
+#ifndef BENCH_FRAMES
+#define BENCH_FRAMES 100
+#endif
+
+// GPIOR0 values: begin = stage, end = stage | 0x40
+#define BENCH_END 0x40
+#define BENCH_DONE 0xFF
+#define BENCH_BLEND 0x40 // GPIOR1 while timing the blend modes
+#define BENCH_PARTICLES 0x50 // and the particles
+#define BENCH_PALETTE 0x60 // and the palette lookups
+#define BENCH_HISTORY 0x70 // and the spectrum history
+#define BENCH_POST 0xC0 // and blur and bloom, above the audio effects
+#define BENCH_VM 0xD0 // and the bytecode programs
+
+#define STAGE_BEGIN(stage) GPIOR0 = (stage)
+#define STAGE_END(stage) GPIOR0 = (stage) | BENCH_END
+
+uint16_t benchFrames = 0;
+
+// Timed before the sweep, each in the header of what it times (its own
+// #ifdef BENCHMARK), which comes after this one
+void layerBench();
+void particleBench();
+void paletteBench();
+void historyBench();
+void blurBench();
+#ifdef VM
+void vmBench();
+#endif
+
+// Start the sweep with the first audio effect, ignoring stored settings
+void benchSetup() {
+  layerBench();
+  particleBench();
+  paletteBench();
+  historyBench();
+  blurBench();
+#ifdef VM
+  vmBench();
+#endif
+  audioEnabled = true;
+  numEffects = numEffectsAudio;
+  currentEffect = 0;
+  autoCycle = false;
+  effectInit = false;
+  GPIOR1 = 0x80;
+}
+
+// Count an effect frame and move to the next effect when it has run long enough
+void benchFrame() {
+  if (++benchFrames < BENCH_FRAMES) return;
+  benchFrames = 0;
+
+  if (++currentEffect >= numEffects) {
+    if (!audioEnabled) {
+      GPIOR0 = BENCH_DONE;
+      cli();
+      sleep_enable();
+      for (;;) sleep_cpu(); // simavr stops on sleep with interrupts disabled
+    }
+    audioEnabled = false;
+    numEffects = numEffectsNoAudio;
+    currentEffect = 0;
+  }
+
+  effectInit = false;
+  audioActive = false;
+  fillAll(CRGB::Black);
+  GPIOR1 = currentEffect | (audioEnabled << 7);
+}
+
+#elif defined(PROFILING)
+
+#define HISTBUCKETS 16
+
+#define STAGE_BEGIN(stage) stageMicros = micros()
+#define STAGE_END(stage) profileStage(stage, micros() - stageMicros)
+
+unsigned long stageMicros; // start of the current stage, stages don't nest
+byte stageHistogram[NUMSTAGES][HISTBUCKETS];
+byte profileEffect = 0; // effect the histograms belong to
+
+void profileDump() {
+  for (byte stage = 0; stage < NUMSTAGES; stage++) {
+    byte used = 0;
+    for (byte b = 0; b < HISTBUCKETS; b++) used |= stageHistogram[stage][b];
+    if (!used) continue;
+
+    Serial.print('H');
+    Serial.print(',');
+    Serial.print(profileEffect);
+    Serial.print(',');
+    Serial.print(stage);
+    for (byte b = 0; b < HISTBUCKETS; b++) {
+      Serial.print(',');
+      Serial.print(stageHistogram[stage][b]);
+    }
+    Serial.println();
+  }
+  memset(stageHistogram, 0, sizeof(stageHistogram));
+}
+
+void profileStage(byte stage, unsigned long duration) {
+  byte running = currentEffect | (audioEnabled << 7);
+  if (running != profileEffect) {
+    profileDump();
+    profileEffect = running;
+  }
+
+  byte bucket = 0;
+  while (duration && bucket < HISTBUCKETS - 1) {
+    duration >>= 1;
+    bucket++;
+  }
+
+  if (++stageHistogram[stage][bucket] == 255) {
+    for (byte b = 0; b < HISTBUCKETS; b++) stageHistogram[stage][b] >>= 1;
+  }
+}
+
+#else
+
+#define STAGE_BEGIN(stage)
+#define STAGE_END(stage)
+
+#endif
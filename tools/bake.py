@@ -0,0 +1,193 @@
+#!/usr/bin/env python3
+"""Bake an effect into a flash animation for animation.h.
+
+    bake.py EFFECT [--frames N] [--runner PATH] [--name NAME] [-o FILE]
+
+Runs the deterministic host runner on EFFECT (a name from hostEffects in
+host/main.cpp), takes the LEDs after every effect frame and writes a header
+with the frames, palette and Animation for playAnimation(). If the frames
+repeat from the start, only one cycle is kept; otherwise all N are, and the
+animation jumps back to the first at the end.
+
+More than 256 colours are cut down to 256 by median cut, and the largest
+channel error is reported. The compressed size is printed on stderr, along
+with what share of the 32 KB of flash it would take.
+"""
+
+import argparse
+import collections
+import os
+import struct
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from sketch import ROOT, last_visible_led
+
+LEDS = last_visible_led() + 1
+RECORD = 4 + LEDS * 3
+FLASH = 32768
+
+
+def run(runner, effect, frames):
+    """Return [(effectDelay, [(r, g, b)] * LEDS)] for each effect frame."""
+    with tempfile.NamedTemporaryFile(suffix=".bin") as bake:
+        subprocess.run([runner, "--sweep", str(frames), "--effect", effect, "--bake", bake.name],
+                       check=True, stdout=subprocess.DEVNULL)
+        data = open(bake.name, "rb").read()
+    out = []
+    for offset in range(0, len(data) - RECORD + 1, RECORD):
+        delay = struct.unpack_from("<I", data, offset)[0]
+        rgb = data[offset + 4:offset + RECORD]
+        out.append((delay, [tuple(rgb[i:i + 3]) for i in range(0, len(rgb), 3)]))
+    return out
+
+
+def find_loop(frames):
+    """Length of the cycle the frames repeat from the start with, or None."""
+    for period in range(1, len(frames) // 2 + 1):
+        if frames[period:] == frames[:-period]:
+            return period
+    return None
+
+
+def median_cut(colors, count):
+    """Up to count colours standing in for the (colour, weight) pairs given."""
+    boxes = [colors]
+    while len(boxes) < count:
+        best = None
+        for n, box in enumerate(boxes):
+            if len(box) < 2:
+                continue
+            ranges = [max(c[0][ch] for c in box) - min(c[0][ch] for c in box) for ch in range(3)]
+            if best is None or max(ranges) > best[0]:
+                best = (max(ranges), n, ranges.index(max(ranges)))
+        if best is None or best[0] == 0:
+            break
+        _, n, ch = best
+        box = sorted(boxes.pop(n), key=lambda c: c[0][ch])
+        half = len(box) // 2
+        boxes += [box[:half], box[half:]]
+    palette = []
+    for box in boxes:
+        weight = sum(w for _, w in box)
+        palette.append(tuple((sum(c[ch] * w for c, w in box) + weight // 2) // weight for ch in range(3)))
+    return palette
+
+
+def quantize(frames):
+    """Return (palette, frames of palette indices, largest channel error)."""
+    counts = collections.Counter(c for frame in frames for c in frame)
+    order = list(dict.fromkeys(c for frame in frames for c in frame))
+    if len(order) <= 256:
+        palette = order
+    else:
+        palette = median_cut([(c, counts[c]) for c in order], 256)
+    index = {}
+    error = 0
+    for c in order:
+        best = min(range(len(palette)), key=lambda i: sum((a - b) ** 2 for a, b in zip(c, palette[i])))
+        index[c] = best
+        error = max(error, max(abs(a - b) for a, b in zip(c, palette[best])))
+    return palette, [[index[c] for c in frame] for frame in frames], error
+
+
+def encode_frame(frame, previous):
+    """Control bytes for one frame, as described in animation.h."""
+    out = []
+    i = 0
+    while i < LEDS:
+        # unchanged
+        run = 0
+        while previous and i + run < LEDS and frame[i + run] == previous[i + run] and run < 128:
+            run += 1
+        if run:
+            out.append(run - 1)
+            i += run
+            continue
+        # the same index over and over
+        run = 1
+        while i + run < LEDS and frame[i + run] == frame[i] and run < 64:
+            run += 1
+        if run >= 3:
+            out += [0xC0 | (run - 1), frame[i]]
+            i += run
+            continue
+        # anything else, until something above would do better
+        start = i
+        while i < LEDS and i - start < 64:
+            if previous and i + 1 < LEDS and frame[i] == previous[i] and frame[i + 1] == previous[i + 1]:
+                break
+            if i + 2 < LEDS and frame[i] == frame[i + 1] == frame[i + 2]:
+                break
+            i += 1
+        if i == start:
+            i += 1
+        out.append(0x80 | (i - start - 1))
+        out += frame[start:i]
+    return out
+
+
+def c_array(name, values):
+    lines = []
+    for n in range(0, len(values), 16):
+        lines.append("  " + ", ".join(str(v) for v in values[n:n + 16]) + ",")
+    return "const byte %s[] PROGMEM = {\n%s\n};\n" % (name, "\n".join(lines))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("effect")
+    parser.add_argument("--frames", type=int, default=500, help="effect frames to run (default 500)")
+    parser.add_argument("--runner", default=os.path.join(ROOT, "build", "rgbshades_deterministic"))
+    parser.add_argument("--name", help="prefix for the arrays (default: the effect name)")
+    parser.add_argument("-o", "--output", help="header to write (default: stdout)")
+    args = parser.parse_args()
+    name = args.name or args.effect
+
+    baked = run(args.runner, args.effect, args.frames)
+    if not baked:
+        sys.exit("%s drew no frames" % args.effect)
+    delays = collections.Counter(d for d, _ in baked)
+    delay = delays.most_common(1)[0][0]
+    frames = [f for _, f in baked]
+    period = find_loop(frames)
+    if period:
+        frames = frames[:period]
+
+    palette, indexed, error = quantize(frames)
+    data = []
+    previous = None
+    for frame in indexed:
+        data += encode_frame(frame, previous)
+        previous = frame
+    flat = [v for c in palette for v in c]
+    size = len(data) + len(flat) + 8
+
+    header = "// %s, baked by tools/bake.py from %s: %d frames%s, %d colours\n" % (
+        name, args.effect, len(frames), " (one cycle)" if period else "", len(palette))
+    header += "// %d bytes of flash\n" % size
+    header += c_array(name + "Frames", data)
+    header += c_array(name + "Palette", flat)
+    header += "const Animation %sAnimation PROGMEM = {%sFrames, %sPalette, %d, %d};\n" % (
+        name, name, name, len(frames), delay)
+    if args.output:
+        open(args.output, "w").write(header)
+    else:
+        sys.stdout.write(header)
+
+    raw = len(frames) * LEDS * 3
+    print("%s: %d frames%s, delay %d ms, %d colours%s" % (
+        args.effect, len(frames), " (loops)" if period else " (no loop found, jumps back)", delay,
+        len(palette), ", largest error %d" % error if error else ""), file=sys.stderr)
+    if len(delays) > 1:
+        print("  effectDelay varied (%s), playing at %d" % (
+            ", ".join(str(d) for d in sorted(delays)), delay), file=sys.stderr)
+    print("  %d bytes (frames %d, palette %d), %.1f bytes a frame, %.1f%% of raw, %.1f%% of %d KB flash" % (
+        size, len(data), len(flat), len(data) / len(frames), 100.0 * len(data) / raw,
+        100.0 * size / FLASH, FLASH // 1024), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
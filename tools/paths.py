@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+"""Generate pathdata.h, the LED paths for paths.h, from the layout in XYmap.h.
+
+    paths.py > pathdata.h
+
+Paths are lists of LED indexes in order: the outline of the shades and of
+each lens, clockwise from the top left, and each row from left to right.
+Outlines are traced around the visible LEDs with Moore neighbour tracing,
+so they follow the notch for the nose.
+
+Also the lines blur.h runs along: every unbroken run of two or more visible
+LEDs in a row (blurRows) or a column (blurColumns), as a length and then
+the LEDs, ending with a 0. Runs stop at the bridge and the corners, so
+nothing is spread into LEDs that aren't there.
+"""
+
+import os
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from sketch import last_visible_led, shades_layout
+
+# clockwise, starting from west, with y growing downwards
+AROUND = [(-1, 0), (-1, -1), (0, -1), (1, -1), (1, 0), (1, 1), (0, 1), (-1, 1)]
+
+
+def trace(cells):
+    """Boundary of a set of (x, y) cells, clockwise from the top left one."""
+    start = min(cells, key=lambda c: (c[1], c[0]))
+    path = [start]
+    current = start
+    came_from = 0  # the west neighbour of the top left cell is always outside
+    while True:
+        for turn in range(8):
+            d = (came_from + turn) % 8
+            nx, ny = current[0] + AROUND[d][0], current[1] + AROUND[d][1]
+            if (nx, ny) in cells:
+                # next search starts from the neighbour checked just before this one
+                previous = AROUND[(d + 7) % 8]
+                back = (current[0] + previous[0] - nx, current[1] + previous[1] - ny)
+                came_from = AROUND.index(back)
+                current = (nx, ny)
+                break
+        else:
+            return path  # a single cell
+        if current == start:
+            return path
+        path.append(current)
+
+
+def runs(lines, visible):
+    """Unbroken runs of two or more visible cells along each line of cells."""
+    out = []
+    for line in lines:
+        run = []
+        for cell in line + [None]:
+            if cell in visible:
+                run.append(cell)
+                continue
+            if len(run) > 1:
+                out.append(run)
+            run = []
+    return out
+
+
+def blur_lines(name, lines, table, width):
+    values = []
+    for line in lines:
+        values += [len(line)] + [table[y * width + x] for x, y in line]
+    values.append(0)
+    return "const byte %s[] PROGMEM = {%s}; // %d LEDs" % (
+        name, ", ".join(str(v) for v in values), len(values) - len(lines) - 1)
+
+
+def main():
+    width, height, table = shades_layout()
+    last = last_visible_led()
+    visible = {(x, y) for y in range(height) for x in range(width) if table[y * width + x] <= last}
+
+    paths = [("Outline", trace(visible)),
+             ("LeftRim", trace({c for c in visible if c[0] < width // 2})),
+             ("RightRim", trace({c for c in visible if c[0] >= width // 2}))]
+    for y in range(height):
+        paths.append(("Row%d" % y, [(x, y) for x in range(width) if (x, y) in visible]))
+
+    out = ["// LED paths for paths.h, generated from the layout in XYmap.h by tools/paths.py",
+           "// Rerun it (tools/paths.py > pathdata.h) if the layout changes.", "",
+           "struct Path {", "  const byte *leds;", "  byte length;", "};", ""]
+    for number, (name, cells) in enumerate(paths):
+        out.append("#define PATH%s %d" % (name.upper(), number))
+    out.append("#define NUMPATHS %d" % len(paths))
+    out.append("")
+    for name, cells in paths:
+        leds = [table[y * width + x] for x, y in cells]
+        out.append("const byte path%s[] PROGMEM = {%s};" % (name, ", ".join(str(i) for i in leds)))
+    out.append("")
+    out.append("const Path pathTable[NUMPATHS] PROGMEM = {")
+    for name, cells in paths:
+        out.append("  {path%s, %d}," % (name, len(cells)))
+    out.append("};")
+    out.append("")
+    rows = runs([[(x, y) for x in range(width)] for y in range(height)], visible)
+    columns = runs([[(x, y) for y in range(height)] for x in range(width)], visible)
+    out.append(blur_lines("blurRows", rows, table, width))
+    out.append(blur_lines("blurColumns", columns, table, width))
+    print("\n".join(out))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+"""Static RAM per part of the sketch, from a compiled AVR firmware.
+
+    ramreport.py firmware.elf [--nm avr-nm]
+
+Lists every variable in .data and .bss with its size and the part of the
+sketch it belongs to, decided by which header defines it (function-local
+statics go with the header of their function). Anything not defined in the
+sketch is counted as "libraries" (FastLED, the Arduino core, Serial buffers).
+The remainder of the 2 KB is what the stack has to live in.
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from sketch import ROOT
+
+RAM_SIZE = 2048
+
+PARTS = {
+    "XYmap.h": "leds",
+    "audio.h": "audio",
+    "history.h": "audio",
+    "effects.h": "effects",
+    "animation.h": "effects",
+    "layers.h": "effects",
+    "particles.h": "effects",
+    "paths.h": "effects",
+    "blur.h": "effects",
+    "show.h": "effects",
+    "vm.h": "effects",
+    "buttons.h": "buttons",
+    "utils.h": "core",
+    "RGBShadesAudio.ino": "core",
+}
+
+# globals that belong somewhere other than the header that defines them
+OVERRIDES = {
+    "currentPalette": "palettes",
+    "paletteCache": "palettes",
+    "noise": "effects",
+    "nx": "effects",
+    "ny": "effects",
+    "nz": "effects",
+    "scale": "effects",
+    "nspeed": "effects",
+    "charBuffer": "effects",
+    "currentStringAddress": "effects",
+}
+
+
+def defined_names():
+    """Map identifiers defined at file or function scope to the part of the sketch they belong to."""
+    owners = {}
+    for name in sorted(os.listdir(ROOT)):
+        if not (name.endswith(".h") or name.endswith(".ino")):
+            continue
+        part = PARTS.get(name, os.path.splitext(name)[0])
+        source = open(os.path.join(ROOT, name)).read()
+        # functions, so "effect()::variable" statics can be attributed
+        for m in re.finditer(r"^\w[\w\s\*]*?\b(\w+)\s*\([^;{]*\)\s*\{", source, re.M):
+            owners.setdefault(m.group(1), part)
+        # globals
+        for m in re.finditer(r"^(?:static\s+)?(?:const\s+)?\w[\w\s\*]*?\b(\w+)\s*(?:\[[^\]]*\])*\s*(?:=|;)", source, re.M):
+            owners.setdefault(m.group(1), part)
+    owners.update(OVERRIDES)
+    return owners
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("elf")
+    parser.add_argument("--nm", default="avr-nm")
+    args = parser.parse_args()
+
+    output = subprocess.check_output([args.nm, "-C", "-S", "--size-sort", "-t", "d", args.elf], text=True)
+    owners = defined_names()
+
+    totals = {}
+    symbols = []
+    for line in output.splitlines():
+        fields = line.split(None, 3)
+        if len(fields) != 4 or fields[2].lower() not in ("b", "d"):
+            continue
+        size, name = int(fields[1]), fields[3]
+        base = name.split("::")[0].split("(")[0]
+        part = owners.get(base, "libraries")
+        totals[part] = totals.get(part, 0) + size
+        symbols.append((size, part, name))
+
+    for size, part, name in sorted(symbols, reverse=True):
+        print("%6d  %-10s %s" % (size, part, name))
+
+    print()
+    used = sum(totals.values())
+    for part in sorted(totals, key=totals.get, reverse=True):
+        print("%-10s %6d bytes" % (part, totals[part]))
+    print("%-10s %6d bytes" % ("total", used))
+    print("%-10s %6d bytes left for the stack" % ("free", RAM_SIZE - used))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
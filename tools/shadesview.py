@@ -0,0 +1,239 @@
+#!/usr/bin/env python3
+"""Receive frames streamed by a STREAMING build (see stream.h).
+
+    shadesview.py --port /dev/ttyUSB0 [--baud 115200]   live, needs pyserial
+    shadesview.py capture.bin [--check dump.bin]         from captured Serial output
+    shadesview.py --dump dump.bin [--against other.bin] [--frame N]
+
+Frames are drawn in the terminal in the shape of the shades, using the
+layout in XYmap.h and 24-bit ANSI colours. Once a second (or at the end of a
+capture) the achieved frame rate, skipped frames, bad packets and the
+streaming overhead reported by the shades are printed.
+
+--check compares every received frame with the frame of the same number in a
+host --dump of the same run (rgbshades_stream --serial capture.bin --dump
+dump.bin) and fails on any difference.
+
+--dump draws frame N (default the last) of a host --dump. With --against,
+the same frame of another dump is drawn beside it, for example a run with
+--blur or --bloom against one without, along with the largest channel
+difference and the total light in each.
+"""
+
+import argparse
+import os
+import struct
+import sys
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from sketch import last_visible_led, shades_layout
+
+LEDS = last_visible_led() + 1
+MASK_BYTES = (LEDS + 7) // 8
+DUMP_RECORD = 4 + LEDS * 3
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+class Receiver:
+    def __init__(self):
+        self.frame = [(0, 0, 0)] * LEDS
+        self.have_key = False
+        self.buffer = bytearray()
+        self.number = None
+        self.frames = 0
+        self.skipped = 0
+        self.bad = 0
+        self.overhead = None
+        self.device_sent = 0
+        self.device_skipped = 0
+
+    def feed(self, data):
+        """Add received bytes, return the numbers of the frames completed."""
+        completed = []
+        for byte in data:
+            if byte:
+                self.buffer.append(byte)
+                continue
+            packet = cobs_decode(bytes(self.buffer))
+            self.buffer = bytearray()
+            if packet is None or len(packet) < 2 or sum(packet[:-1]) & 0xFF != packet[-1]:
+                self.bad += 1
+                continue
+            number = self.packet(packet[:-1])
+            if number is not None:
+                completed.append(number)
+        return completed
+
+    def packet(self, p):
+        kind = p[0:1]
+        if kind == b"S" and len(p) == 7:
+            self.device_sent, self.device_skipped, self.overhead = struct.unpack("<HHH", p[1:])
+            return None
+        if kind == b"F" and len(p) == 3 + LEDS * 3:
+            rgb = p[3:]
+            self.frame = [tuple(rgb[i * 3:i * 3 + 3]) for i in range(LEDS)]
+            self.have_key = True
+        elif kind == b"D" and len(p) >= 3 + MASK_BYTES and self.have_key:
+            mask = p[3:3 + MASK_BYTES]
+            rgb = p[3 + MASK_BYTES:]
+            changed = [i for i in range(LEDS) if mask[i // 8] & (1 << (i % 8))]
+            if len(rgb) != len(changed) * 3:
+                self.bad += 1
+                return None
+            for n, i in enumerate(changed):
+                self.frame[i] = tuple(rgb[n * 3:n * 3 + 3])
+        else:
+            if kind != b"D":
+                self.bad += 1
+            return None
+
+        number = struct.unpack("<H", p[1:3])[0]
+        if self.number is not None:
+            self.skipped += (number - self.number - 1) & 0xFFFF
+        self.number = number
+        self.frames += 1
+        return number
+
+
+def draw(frame):
+    width, height, table = shades_layout()
+    lines = []
+    for y in range(height):
+        line = ""
+        for x in range(width):
+            i = table[y * width + x]
+            if i < LEDS:
+                r, g, b = frame[i]
+                line += "\x1b[48;2;%d;%d;%dm  " % (r, g, b)
+            else:
+                line += "\x1b[0m  "
+        lines.append(line + "\x1b[0m")
+    return "\n".join(lines)
+
+
+def dump_frame(path, number):
+    dump = open(path, "rb").read()
+    frames = len(dump) // DUMP_RECORD
+    if not frames:
+        sys.exit("%s: no frames" % path)
+    if number is None or number >= frames:
+        number = frames - 1
+    rgb = dump[number * DUMP_RECORD + 4:(number + 1) * DUMP_RECORD]
+    return number, [tuple(rgb[i:i + 3]) for i in range(0, len(rgb), 3)]
+
+
+def compare_dumps(args):
+    number, frame = dump_frame(args.dump, args.frame)
+    if not args.against:
+        if args.draw:
+            print(draw(frame))
+        print("frame %d, total light %d" % (number, sum(map(sum, frame))))
+        return 0
+    _, other = dump_frame(args.against, number)
+    if args.draw:
+        for left, right in zip(draw(frame).split("\n"), draw(other).split("\n")):
+            print(left + "    " + right)
+    difference = max(abs(a - b) for x, y in zip(frame, other) for a, b in zip(x, y))
+    print("frame %d, total light %d against %d, largest difference %d" % (
+        number, sum(map(sum, frame)), sum(map(sum, other)), difference))
+    return 0
+
+
+def stats(rx, seconds):
+    text = "%d frames" % rx.frames
+    if seconds:
+        text += ", %.1f fps" % (rx.frames / seconds)
+    text += ", %d skipped" % rx.skipped
+    if rx.frames:
+        text += " (%.0f%% of shown frames received)" % (100.0 * rx.frames / (rx.frames + rx.skipped))
+    text += ", %d bad packets" % rx.bad
+    if rx.overhead is not None:
+        text += ", %d us/frame streaming overhead" % rx.overhead
+    return text
+
+
+def check(rx_frames, dump_path):
+    dump = open(dump_path, "rb").read()
+    failures = 0
+    for number, frame in rx_frames:
+        offset = (number - 1) * DUMP_RECORD
+        if offset + DUMP_RECORD > len(dump):
+            continue
+        rgb = dump[offset + 4:offset + DUMP_RECORD]
+        if bytes(c for led in frame for c in led) != rgb:
+            failures += 1
+    print("%d of %d frames differ from %s" % (failures, len(rx_frames), dump_path))
+    return failures == 0
+
+
+def live(args):
+    import serial
+    rx = Receiver()
+    with serial.Serial(args.port, args.baud, timeout=0.05) as s:
+        start = report = time.time()
+        while True:
+            completed = rx.feed(s.read(4096))
+            now = time.time()
+            if completed and args.draw:
+                sys.stdout.write("\x1b[H" + draw(rx.frame) + "\n")
+            if now - report >= 1.0:
+                sys.stdout.write("\x1b[K" + stats(rx, now - start) + "\n")
+                sys.stdout.flush()
+                report = now
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("capture", nargs="?", help="file with captured Serial output (default stdin)")
+    parser.add_argument("--port")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--no-draw", dest="draw", action="store_false")
+    parser.add_argument("--check", metavar="DUMP")
+    parser.add_argument("--dump", help="draw a frame of a host --dump instead")
+    parser.add_argument("--against", metavar="DUMP", help="with --dump, draw another dump beside it")
+    parser.add_argument("--frame", type=int, help="with --dump, the frame to draw (default the last)")
+    args = parser.parse_args()
+
+    if args.dump:
+        return compare_dumps(args)
+
+    if args.port:
+        if args.draw:
+            sys.stdout.write("\x1b[2J")
+        try:
+            live(args)
+        except KeyboardInterrupt:
+            pass
+        return 0
+
+    data = open(args.capture, "rb").read() if args.capture else sys.stdin.buffer.read()
+    rx = Receiver()
+    received = []
+    for byte in data:
+        for number in rx.feed(bytes([byte])):
+            received.append((number, list(rx.frame)))
+
+    if args.draw and received:
+        print(draw(received[-1][1]))
+    print(stats(rx, 0))
+    if args.check:
+        return 0 if check(received, args.check) else 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
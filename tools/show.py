@@ -0,0 +1,266 @@
+#!/usr/bin/env python3
+"""Compile a song into a show for show.h: a cue list in flash.
+
+    show.py SONG.wav [--effects NAME,...] [--palettes N,...] [--onsets] [-o showdata.h]
+
+Runs the host runner's MSGEQ7 model (host/msgeq7.h) over the song, so the
+analysis hears what the shades would, and finds in its levels:
+
+  onsets    rises in the levels over all bands (spectral flux), picked
+            against the average around them
+  tempo     the beat period with the strongest autocorrelation of the flux,
+            between 60 and 200 BPM and leaning towards 120
+  beats     a grid at that period, each beat moved to the strongest flux
+            within 40 ms of where it was expected
+  sections  bar lines where the bands' log levels over the 4 bars before
+            differ most from those over the 4 bars after, at least --min-bars
+            apart
+
+Each section switches to the next of --effects (names from the effect lists
+in RGBShadesAudio.ino, non-audio ones by default) and --palettes, with the
+brightness following the section's loudness and a new hue. Every beat, or
+every onset with --onsets, is a beat for beatDetect(). The cue format and
+types are read from show.h.
+"""
+
+import argparse
+import math
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from sketch import ROOT, effect_lists
+
+ROWMS = 10           # --levels writes a row every 10 ms
+OFFSET = 60          # MSGEQ7_OFFSET, the levels at silence
+FLASH = 32768
+
+
+def show_constants():
+    """The CUE* defines from show.h, e.g. {"BEAT": 1, ..., "MAXGAP": 8191}."""
+    source = open(os.path.join(ROOT, "show.h")).read()
+    return {name: int(value) for name, value in re.findall(r"#define\s+CUE(\w+)\s+(\d+)", source)}
+
+
+def levels(runner, wav, gain):
+    """Rows of 7 band levels over silence, one every ROWMS ms."""
+    with tempfile.NamedTemporaryFile(suffix=".txt") as out:
+        subprocess.run([runner, "--wav", wav, "--wav-gain", str(gain), "--levels", out.name],
+                       check=True, stdout=subprocess.DEVNULL)
+        rows = []
+        for line in open(out.name):
+            if line.startswith("#") or not line.strip():
+                continue
+            rows.append([max(0, int(v) - OFFSET) for v in line.split()])
+    return rows
+
+
+def flux(rows):
+    """How much the bands rose since the row before, summed."""
+    out = [0.0]
+    for previous, row in zip(rows, rows[1:]):
+        out.append(float(sum(max(0, a - b) for a, b in zip(row, previous))))
+    return out
+
+
+def onsets(strength, gap=10, window=50):
+    """Rows where the flux peaks well over the average around it, gap rows apart at least."""
+    prefix = [0.0]
+    for s in strength:
+        prefix.append(prefix[-1] + s)
+    picked = []
+    for t in range(1, len(strength) - 1):
+        s = strength[t]
+        if s <= 0 or s < max(strength[max(0, t - 3):t + 4]):
+            continue
+        lo, hi = max(0, t - window), min(len(strength), t + window)
+        if s < 1.5 * (prefix[hi] - prefix[lo]) / (hi - lo) + 1:
+            continue
+        if picked and t - picked[-1] < gap:
+            continue
+        picked.append(t)
+    return picked
+
+
+def tempo(strength):
+    """Beat period in rows (fractional), by autocorrelation between 60 and 200 BPM."""
+    mean = sum(strength) / len(strength)
+    centred = [s - mean for s in strength]
+    shortest, longest = int(60000 / 200 / ROWMS), int(60000 / 60 / ROWMS) + 1
+    scores = {}
+    for lag in range(shortest - 1, longest + 2):
+        scores[lag] = sum(a * b for a, b in zip(centred, centred[lag:]))
+    best, weighted = None, None
+    for lag in range(shortest, longest + 1):
+        bpm = 60000.0 / (lag * ROWMS)
+        w = scores[lag] * math.exp(-0.5 * math.log2(bpm / 120) ** 2)
+        if weighted is None or w > weighted:
+            best, weighted = lag, w
+    # between rows, from the parabola through the peak and its neighbours
+    a, b, c = scores[best - 1], scores[best], scores[best + 1]
+    bend = a - 2 * b + c
+    return best + (0.5 * (a - c) / bend if bend < 0 else 0)
+
+
+def beats(strength, period):
+    """Beat rows: the best phase for the period, then each beat snapped to the flux near it."""
+    phase = max(range(int(round(period))),
+                key=lambda p: sum(strength[int(round(p + k * period))]
+                                  for k in range(int((len(strength) - 1 - p) / period) + 1)))
+    out = []
+    expected = float(phase)
+    while expected - period > -5:  # a beat right at the start has no rise before it to find
+        expected -= period
+    while expected < len(strength):
+        centre = int(round(expected))
+        lo, hi = max(0, centre - 4), min(len(strength), centre + 5)
+        t = max(range(lo, hi), key=lambda r: (strength[r], -abs(r - centre)))
+        if strength[t] <= 0:
+            t = min(centre, len(strength) - 1)
+        out.append(t)
+        # follow the music a little, but keep the period
+        expected = 0.75 * (expected + period) + 0.25 * (t + period)
+    return out
+
+
+def sections(rows, beat_rows, min_bars, around=4):
+    """First beat index of each section, and each section's mean level."""
+    bars = []
+    for n in range(0, len(beat_rows), 4):
+        start = beat_rows[n]
+        end = beat_rows[n + 4] if n + 4 < len(beat_rows) else len(rows)
+        span = rows[start:end] or [rows[min(start, len(rows) - 1)]]
+        bars.append([sum(r[b] for r in span) / len(span) for b in range(7)])
+    if not bars:
+        return [0], [0.0]
+    # compared by log level, so a quiet band coming in counts as much as a loud one
+    heard = [[math.log1p(v) for v in bar] for bar in bars]
+
+    def mean(span):
+        return [sum(bar[b] for bar in span) / len(span) for b in range(7)]
+
+    novelty = [0.0] * len(bars)
+    for i in range(1, len(bars)):
+        before, after = mean(heard[max(0, i - around):i]), mean(heard[i:i + around])
+        novelty[i] = math.sqrt(sum((x - y) ** 2 for x, y in zip(before, after)))
+    average = sum(novelty) / len(novelty)
+    spread = math.sqrt(sum((n - average) ** 2 for n in novelty) / len(novelty))
+    starts = [0]
+    for i in sorted(range(1, len(bars)), key=lambda i: -novelty[i]):
+        if novelty[i] < average + spread / 2:
+            break
+        if all(abs(i - s) >= min_bars for s in starts) and len(bars) - i >= min_bars // 2:
+            starts.append(i)
+    starts.sort()
+    loudness = []
+    for n, start in enumerate(starts):
+        end = starts[n + 1] if n + 1 < len(starts) else len(bars)
+        loudness.append(sum(sum(bar) for bar in bars[start:end]) / (end - start))
+    return [s * 4 for s in starts], loudness
+
+
+def effect_value(name, lists):
+    if name in lists["noaudio"]:
+        return lists["noaudio"].index(name)
+    if name in lists["audio"]:
+        return 128 + lists["audio"].index(name)
+    sys.exit("%s isn't in effectListNoAudio[] or effectListAudio[]" % name)
+
+
+def encode(cues, cue):
+    """Cue list bytes for show.h from (ms, type, value) sorted by time."""
+    out = []
+    last = 0
+    for ms, kind, value in cues:
+        gap = ms - last
+        while gap > cue["MAXGAP"]:
+            out += [cue["MAXGAP"] & 0xFF, cue["MAXGAP"] >> 8]
+            gap -= cue["MAXGAP"]
+        word = kind << cue["TYPESHIFT"] | gap
+        out += [word & 0xFF, word >> 8]
+        if kind not in (cue["WAIT"], cue["BEAT"], cue["END"]):
+            out.append(value)
+        last = ms
+    return out
+
+
+def c_array(name, values):
+    lines = []
+    for n in range(0, len(values), 16):
+        lines.append("  " + ", ".join(str(v) for v in values[n:n + 16]) + ",")
+    return "const byte %s[] PROGMEM = {\n%s\n};\n" % (name, "\n".join(lines))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("song")
+    parser.add_argument("--effects", help="effects, one a section in turn (default: the non-audio list)")
+    parser.add_argument("--palettes", default="0,1,2,4,5,6,7", help="selectPalette() numbers in turn")
+    parser.add_argument("--onsets", action="store_true", help="cue a beat on every onset, not on the beat grid")
+    parser.add_argument("--bpm", type=float, help="use this tempo instead of finding it")
+    parser.add_argument("--min-bars", type=int, default=8, help="shortest section in bars of 4 beats (default 8)")
+    parser.add_argument("--gain", type=float, default=2.0, help="--wav-gain for the runner (default 2)")
+    parser.add_argument("--runner", default=os.path.join(ROOT, "build", "rgbshades_host"))
+    parser.add_argument("-o", "--output", help="header to write (default: stdout)")
+    args = parser.parse_args()
+
+    cue = show_constants()
+    lists = effect_lists()
+    names = args.effects.split(",") if args.effects else lists["noaudio"]
+    effects = [effect_value(n, lists) for n in names]
+    palettes = [int(p) for p in args.palettes.split(",")]
+
+    rows = levels(args.runner, args.song, args.gain)
+    if len(rows) < 200:
+        sys.exit("%s: too short for a show" % args.song)
+    strength = flux(rows)
+    period = 60000.0 / args.bpm / ROWMS if args.bpm else tempo(strength)
+    beat_rows = beats(strength, period)
+    starts, loudness = sections(rows, beat_rows, args.min_bars)
+    loudest = max(loudness) or 1
+
+    cues = []
+    for n, start in enumerate(starts):
+        ms = 0 if n == 0 else beat_rows[start] * ROWMS
+        cues.append((ms, cue["EFFECT"], effects[n % len(effects)]))
+        cues.append((ms, cue["PALETTE"], palettes[n % len(palettes)]))
+        cues.append((ms, cue["BRIGHTNESS"], int(round(128 + 127 * loudness[n] / loudest))))
+        cues.append((ms, cue["HUE"], n * 96 & 0xFF))
+    hits = onsets(strength) if args.onsets else beat_rows
+    cues += [(t * ROWMS, cue["BEAT"], 0) for t in hits]
+    cues.sort(key=lambda c: c[0])  # stable, so a section's cues stay in order
+    length = len(rows) * ROWMS
+    cues.append((length, cue["END"], 0))
+    data = encode(cues, cue)
+
+    song = os.path.basename(args.song)
+    bpm = 60000.0 / (period * ROWMS)
+    header = "// Show cue list for show.h\n//\n"
+    header += "// Written by tools/show.py, e.g. tools/show.py song.wav -o showdata.h\n"
+    header += "// Recompile rather than edit.\n\n"
+    header += "// %s: %d:%02d, %.1f BPM, %d %s, %d sections, %d cues\n" % (
+        song, length // 60000, length // 1000 % 60, bpm, len(hits), "onsets" if args.onsets else "beats",
+        len(starts), len(cues))
+    header += "// %s\n" % ", ".join(names[n % len(names)] for n in range(len(starts)))
+    header += "// %d bytes of flash\n" % len(data)
+    header += c_array("showCues", data)
+    if args.output:
+        open(args.output, "w").write(header)
+    else:
+        sys.stdout.write(header)
+
+    print("%s: %.1f s, %.1f BPM, %d beats, %d onsets" % (
+        song, length / 1000.0, bpm, len(beat_rows), len(onsets(strength))), file=sys.stderr)
+    for n, start in enumerate(starts):
+        ms = 0 if n == 0 else beat_rows[start] * ROWMS
+        print("  %7.2f s  bar %3d  %-16s loudness %.2f" % (
+            ms / 1000.0, start // 4 + 1, names[n % len(names)], loudness[n] / loudest), file=sys.stderr)
+    print("  %d cues, %d bytes, %.1f%% of %d KB flash" % (
+        len(cues), len(data), 100.0 * len(data) / FLASH, FLASH // 1024), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,80 @@
+"""Helpers for host-side tools that need to know about the sketch."""
+
+import os
+import re
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+SKETCH = os.path.join(ROOT, "RGBShadesAudio.ino")
+
+STAGES = ["updateButtons", "doButtons", "checkEEPROM", "doAnalogs", "effect", "fadeAll", "show", "post"]
+
+
+def effect_lists(bench=False):
+    """Return {"audio": [...], "noaudio": [...]} from the uncommented effect list entries.
+
+    Entries under #ifdef are included when the sketch defines that name, like
+    HISTORYEFFECTS. BENCHMARK and what the sketch defines for it are only
+    defined in the benchmark firmware, and only taken as defined with bench.
+    """
+    lists = {"audio": [], "noaudio": []}
+    try:
+        source = open(SKETCH).read()
+    except OSError:
+        return lists
+    benchmark = re.compile(r"^#ifdef BENCHMARK\n(.*?)^#endif", re.M | re.S)
+    define = re.compile(r"^#define\s+(\w+)", re.M)
+    defined = set(define.findall(benchmark.sub("", source)))
+    if bench:
+        defined.add("BENCHMARK")
+        for block in benchmark.findall(source):
+            defined |= set(define.findall(block))
+    for listname, setname in (("effectListAudio", "audio"), ("effectListNoAudio", "noaudio")):
+        m = re.search(listname + r"\[\]\s*=\s*\{(.*?)\};", source, re.S)
+        if not m:
+            continue
+        skipping = False
+        for line in m.group(1).splitlines():
+            line = line.split("//")[0].strip().rstrip(",").strip()
+            if line.startswith("#"):
+                if line.startswith("#if"):
+                    skipping = re.sub(r"^#if(n?def)?\s*", "", line) not in defined
+                elif line.startswith("#endif"):
+                    skipping = False
+                continue
+            if line and not skipping:
+                lists[setname].append(line)
+    return lists
+
+
+def blend_modes():
+    """Return the blend mode names from layers.h by number, e.g. ["add", "screen", ...]."""
+    source = open(os.path.join(ROOT, "layers.h")).read()
+    modes = {}
+    for name, number in re.findall(r"#define\s+BLEND(\w+)\s+(\d+)", source):
+        modes[int(number)] = name.lower()
+    return [modes[i] for i in sorted(modes)]
+
+
+def effect_name(effect_id):
+    """Name for an effect id as sent by the sketch: list index, plus 128 for the audio list."""
+    setname = "audio" if effect_id & 0x80 else "noaudio"
+    index = effect_id & 0x7F
+    entries = effect_lists()[setname]
+    if index < len(entries):
+        return entries[index]
+    return "%s#%d" % (setname, index)
+
+
+def shades_layout():
+    """Return (width, height, table) from ShadesTable in XYmap.h, table[y * width + x] = LED index."""
+    source = open(os.path.join(ROOT, "XYmap.h")).read()
+    width = int(re.search(r"kMatrixWidth\s*=\s*(\d+)", source).group(1))
+    height = int(re.search(r"kMatrixHeight\s*=\s*(\d+)", source).group(1))
+    m = re.search(r"ShadesTable\[\]\s*=\s*\{(.*?)\};", source, re.S)
+    table = [int(x) for x in re.findall(r"\d+", m.group(1))]
+    return width, height, table
+
+
+def last_visible_led():
+    source = open(os.path.join(ROOT, "XYmap.h")).read()
+    return int(re.search(r"#define\s+LAST_VISIBLE_LED\s+(\d+)", source).group(1))
@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+"""Decode loop stage histograms from a PROFILING build (see timing.h).
+
+    stagehist.py capture.txt            decode lines captured from Serial
+    stagehist.py --port /dev/ttyUSB0    ask the shades for a dump (needs pyserial)
+
+Histograms from repeated dumps of the same effect are added together.
+Percentiles are reported as the upper edge of the log2 bucket they fall in,
+so "<=512" means the stage took at most 511 microseconds.
+"""
+
+import argparse
+import os
+import sys
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from sketch import STAGES, effect_name
+
+BUCKETS = 16
+
+
+def bucket_limit(bucket):
+    if bucket == 0:
+        return "0"
+    if bucket == BUCKETS - 1:
+        return ">=%d" % (1 << (bucket - 1))
+    return "<=%d" % ((1 << bucket) - 1)
+
+
+def percentile(counts, fraction):
+    total = sum(counts)
+    target = fraction * total
+    running = 0
+    for bucket, count in enumerate(counts):
+        running += count
+        if running >= target:
+            return bucket
+    return BUCKETS - 1
+
+
+def parse(lines):
+    histograms = {}
+    for line in lines:
+        fields = line.strip().split(",")
+        if len(fields) != 3 + BUCKETS or fields[0] != "H":
+            continue
+        try:
+            effect, stage = int(fields[1]), int(fields[2])
+            counts = [int(x) for x in fields[3:]]
+        except ValueError:
+            continue
+        total = histograms.setdefault((effect, stage), [0] * BUCKETS)
+        for i, count in enumerate(counts):
+            total[i] += count
+    return histograms
+
+
+def read_port(port, baud, wait):
+    import serial
+    with serial.Serial(port, baud, timeout=wait) as s:
+        time.sleep(2.0)  # opening the port resets the shades on most adapters
+        s.reset_input_buffer()
+        s.write(b"p")
+        return s.read(65536).decode("ascii", "replace").splitlines()
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("capture", nargs="?", help="file with captured Serial output (default stdin)")
+    parser.add_argument("--port")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--wait", type=float, default=1.0)
+    args = parser.parse_args()
+
+    if args.port:
+        lines = read_port(args.port, args.baud, args.wait)
+    elif args.capture:
+        lines = open(args.capture).read().splitlines()
+    else:
+        lines = sys.stdin.read().splitlines()
+
+    histograms = parse(lines)
+    if not histograms:
+        print("no histogram lines found")
+        return 1
+
+    for effect in sorted(set(e for e, _ in histograms)):
+        print(effect_name(effect))
+        print("  %-14s %8s %8s %8s" % ("stage", "samples", "p50 us", "p99 us"))
+        for stage in range(len(STAGES)):
+            counts = histograms.get((effect, stage))
+            if not counts or not sum(counts):
+                continue
+            print("  %-14s %8d %8s %8s" % (STAGES[stage], sum(counts),
+                                           bucket_limit(percentile(counts, 0.5)),
+                                           bucket_limit(percentile(counts, 0.99))))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
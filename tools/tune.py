@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+"""Change the parameters in params.h on a TUNING build over Serial (needs pyserial).
+
+    tune.py --port /dev/ttyUSB0                      list parameters
+    tune.py --port /dev/ttyUSB0 PEAKDECAY=0.08 ...   set some, then list them
+    tune.py --port /dev/ttyUSB0 --save               save the current values to EEPROM
+    tune.py --port /dev/ttyUSB0 --reset              back to the defaults in flash
+
+Values are given and shown as real numbers; the shades keep them in 16-bit
+fixed point and limit them to each parameter's range.
+"""
+
+import argparse
+import sys
+import time
+
+
+class Param:
+    def __init__(self, fields):
+        self.id = int(fields[1])
+        self.name = fields[2]
+        self.raw, self.minimum, self.maximum, self.default, self.fraction = (int(x) for x in fields[3:8])
+
+    def value(self, raw):
+        return raw / float(1 << self.fraction)
+
+    def to_raw(self, value):
+        return min(max(int(round(value * (1 << self.fraction))), 0), 0xFFFF)
+
+    def __str__(self):
+        return "%-20s %10g   (%g to %g, default %g)" % (
+            self.name, self.value(self.raw), self.value(self.minimum), self.value(self.maximum),
+            self.value(self.default))
+
+
+def command(port, text, wait=0.3):
+    # show() blocks interrupts on the shades; the first bytes wake them up, and
+    # after those they stop showing for long enough to take the rest
+    port.write(b"\n")
+    time.sleep(0.01)
+    port.reset_input_buffer()
+    port.write(text.encode("ascii") + b"\n")
+    time.sleep(wait)
+    return port.read(port.in_waiting).decode("ascii", "replace").splitlines()
+
+
+def params(lines):
+    found = {}
+    for line in lines:
+        fields = line.strip().split(",")
+        if len(fields) == 8 and fields[0] == "P":
+            p = Param(fields)
+            found[p.name] = p
+    return found
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("settings", nargs="*", metavar="NAME=VALUE")
+    parser.add_argument("--port", required=True)
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--save", action="store_true")
+    parser.add_argument("--reset", action="store_true")
+    args = parser.parse_args()
+
+    import serial
+    with serial.Serial(args.port, args.baud, timeout=0.5) as port:
+        time.sleep(2.0)  # opening the port resets the shades on most adapters
+        if args.reset:
+            command(port, "r", 0.05)
+
+        table = params(command(port, "l"))
+        if not table:
+            print("no answer, is TUNING enabled?")
+            return 1
+
+        for setting in args.settings:
+            name, _, value = setting.partition("=")
+            p = table.get(name)
+            if not p:
+                print("unknown parameter %s" % name)
+                return 1
+            table.update(params(command(port, "t%d,%d" % (p.id, p.to_raw(float(value))))))
+
+        if args.save:
+            if "W" not in command(port, "w", 0.5):
+                print("no answer to save")
+                return 1
+
+        for p in sorted(table.values(), key=lambda p: p.id):
+            print(p)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
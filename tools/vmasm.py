@@ -0,0 +1,284 @@
+#!/usr/bin/env python3
+"""Assemble bytecode effects for vm.h, and upload them to the shades.
+
+    vmasm.py PROGRAM.vm                         listing and size
+    vmasm.py PROGRAM.vm --line SLOT             the Serial line that uploads it
+    vmasm.py PROGRAM.vm --port /dev/ttyUSB0 --slot SLOT   upload it (needs pyserial)
+    vmasm.py --builtins -o vmdata.h             the built-in programs from tools/vm/
+
+A program is the code for one pixel, in postfix: numbers are pushed, and
+the op names are those of the VM* defines in vm.h in lower case (x, y, t,
+hue, add, sin, hsv...), with "band N" for a spectrum band. It has to end
+with one of pal, hsv or rgb. "delay N" sets effectDelay (default 20).
+Comments start with ';'.
+
+Everything that doesn't depend on x or y is worked out once a frame: each
+such run of ops is moved to the frame code, which stores it in a register,
+and the pixel code loads it instead (at most VMREGS runs, the longest
+first). --no-hoist leaves the program as written, to measure the
+difference. Op numbers and limits are read from vm.h.
+"""
+
+import argparse
+import glob
+import os
+import re
+import sys
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from sketch import ROOT
+
+PROGRAMS = os.path.join(os.path.dirname(os.path.abspath(__file__)), "vm")
+
+
+def vm_defines():
+    """[(name, value)] of the VM* number defines in vm.h, in order."""
+    source = open(os.path.join(ROOT, "vm.h")).read()
+    return [(name, int(value)) for name, value in re.findall(r"#define\s+VM(\w+)\s+(\d+)\b", source)]
+
+
+class Vm:
+    """Ops and limits from vm.h."""
+
+    INPUTS = {"x", "y"}                # what makes a value differ between pixels
+    OUTPUTS = {"pal", "hsv", "rgb"}
+    # stack effect: taken, left
+    EFFECT = {"push": (0, 1), "load": (0, 1), "store": (1, 0), "band": (0, 1), "x": (0, 1), "y": (0, 1),
+              "t": (0, 1), "hue": (0, 1), "dup": (1, 2), "swap": (2, 2), "inv": (1, 1), "sin": (1, 1),
+              "cos": (1, 1), "tri": (1, 1), "end": (0, 0), "pal": (2, 0), "hsv": (3, 0), "rgb": (3, 0)}
+
+    def __init__(self):
+        ordered = vm_defines()
+        defines = dict(ordered)
+        self.ops = {}
+        for name, value in ordered:
+            if name == "OPS":
+                break
+            self.ops[name.lower()] = value
+        self.immediate = {n for n, v in self.ops.items() if v <= self.ops["band"]}
+        self.regs = defines["REGS"]
+        self.stack = defines["STACK"]
+        self.codesize = defines["SLOTSIZE"] - 2
+
+    def effect(self, op):
+        return self.EFFECT.get(op, (2, 1))
+
+
+def parse(path, vm):
+    """Return (delay, [(op, immediate or None)])."""
+    delay = 20
+    code = []
+    words = []
+    for number, line in enumerate(open(path), 1):
+        for word in line.split(";")[0].split():
+            words.append((number, word.lower()))
+    n = 0
+    while n < len(words):
+        number, word = words[n]
+        n += 1
+        where = "%s:%d" % (path, number)
+        if word == "delay" or word in vm.immediate:
+            if n >= len(words) or not words[n][1].isdigit():
+                sys.exit("%s: %s needs a number" % (where, word))
+            value = int(words[n][1])
+            n += 1
+            if value > (65535 if word == "delay" else 255):
+                sys.exit("%s: %d is too big for %s" % (where, value, word))
+            if word == "delay":
+                delay = value
+            elif word in ("load", "store", "end"):
+                sys.exit("%s: %s is for the assembler" % (where, word))
+            else:
+                code.append((word, value))
+        elif word.isdigit():
+            if int(word) > 255:
+                sys.exit("%s: %s doesn't fit a byte" % (where, word))
+            code.append(("push", int(word)))
+        elif word in vm.ops and word not in ("end", "load", "store"):
+            code.append((word, None))
+        else:
+            sys.exit("%s: unknown op %s" % (where, word))
+    if delay > 255:
+        sys.exit("%s: delay is a byte" % path)
+    return delay, code
+
+
+def hoist(code, vm):
+    """Split into frame code and pixel code, moving runs that don't depend on x or y to the frame code."""
+    # each stack entry: (first op, last op, invariant), where the ops in between
+    # compute it and nothing else
+    stack = []
+    runs = []  # invariant runs used by something that isn't
+    for i, (op, _) in enumerate(code):
+        taken, left = vm.effect(op)
+        if len(stack) < taken:
+            sys.exit("stack underflow at op %d (%s)" % (i + 1, op))
+        args = stack[len(stack) - taken:] if taken else []
+        del stack[len(stack) - taken:]
+        contiguous = all(a[1] + 1 == b[0] for a, b in zip(args, args[1:])) and (not args or args[-1][1] + 1 == i)
+        if op in ("dup", "swap"):
+            # the copies aren't computed by a run of their own
+            for a in args:
+                if a[2] and a[1] > a[0]:
+                    runs.append(a)
+            stack += [(i, i, False)] * left
+            continue
+        invariant = op not in vm.INPUTS and op not in vm.OUTPUTS and contiguous and all(a[2] for a in args)
+        if not invariant:
+            for a in args:
+                if a[2] and a[1] > a[0]:
+                    runs.append(a)
+        start = args[0][0] if args and contiguous else i
+        stack += [(start, i, invariant)] * left
+    if stack:
+        sys.exit("%d value(s) left on the stack at the end" % len(stack))
+    if not code or code[-1][0] not in vm.OUTPUTS or sum(op in vm.OUTPUTS for op, _ in code) != 1:
+        sys.exit("a program ends with its only pal, hsv or rgb")
+
+    # the longest runs get the registers, the same run twice shares one
+    chosen = {}
+    for first, last, _ in sorted(runs, key=lambda r: r[0] - r[1]):
+        key = tuple(code[first:last + 1])
+        if key not in chosen and len(chosen) < vm.regs:
+            chosen[key] = len(chosen)
+    frame = []
+    for key, reg in chosen.items():
+        frame += list(key) + [("store", reg)]
+    pixel = []
+    i = 0
+    replaced = {(r[0], r[1]): chosen[tuple(code[r[0]:r[1] + 1])] for r in runs if tuple(code[r[0]:r[1] + 1]) in chosen}
+    while i < len(code):
+        for (first, last), reg in replaced.items():
+            if first == i:
+                pixel.append(("load", reg))
+                i = last + 1
+                break
+        else:
+            pixel.append(code[i])
+            i += 1
+    return frame, pixel
+
+
+def assemble(path, vm, hoisting=True):
+    """Return (program bytes, frame code, pixel code)."""
+    delay, code = parse(path, vm)
+    frame, pixel = hoist(code, vm) if hoisting else ([], code)
+    if not hoisting:
+        hoist(code, vm)  # still check it
+    out = [delay]
+    for op, value in frame + [("end", None)] + pixel:
+        out.append(vm.ops[op])
+        if value is not None:
+            out.append(value)
+    depth = deepest = 0
+    for op, _ in frame + pixel:
+        taken, left = vm.effect(op)
+        depth += left - taken
+        deepest = max(deepest, depth)
+    if deepest > vm.stack:
+        sys.exit("%s: needs a stack of %d, there are %d" % (path, deepest, vm.stack))
+    if len(out) > vm.codesize:
+        sys.exit("%s: %d bytes, a slot holds %d" % (path, len(out), vm.codesize))
+    return out, frame, pixel
+
+
+def listing(frame, pixel):
+    def text(ops):
+        return " ".join(op if value is None else "%s %d" % (op, value) for op, value in ops)
+    return "  frame: %s\n  pixel: %s" % (text(frame) or "-", text(pixel))
+
+
+def c_array(name, values):
+    lines = []
+    for n in range(0, len(values), 16):
+        lines.append("  " + ", ".join(str(v) for v in values[n:n + 16]) + ",")
+    return "const byte %s[] PROGMEM = {\n%s\n};\n" % (name, "\n".join(lines))
+
+
+def builtins(vm):
+    paths = sorted(glob.glob(os.path.join(PROGRAMS, "*.vm")))
+    names = [os.path.splitext(os.path.basename(p))[0] for p in paths]
+    out = "// Built-in programs for vm.h\n//\n"
+    out += "// Written by tools/vmasm.py --builtins -o vmdata.h from tools/vm/*.vm\n"
+    out += "// Reassemble rather than edit. The BENCHMARK build also has each one as\n"
+    out += "// written, without moving anything to the frame code, at VMBUILTINS + n.\n\n"
+    out += "struct VmProgram {\n  const byte *code;\n  byte length;\n};\n\n"
+    flat = ""
+    for n, (path, name) in enumerate(zip(paths, names)):
+        data, frame, pixel = assemble(path, vm)
+        cname = "vm" + name[0].upper() + name[1:]
+        out += "// %s.vm: %d bytes, %d ops a pixel\n" % (name, len(data), len(pixel))
+        out += c_array(cname + "Code", data)
+        out += "#define VM%s %d\n\n" % (name.upper(), n)
+        data, frame, pixel = assemble(path, vm, hoisting=False)
+        flat += "// %s.vm as written: %d bytes, %d ops a pixel\n" % (name, len(data), len(pixel))
+        flat += c_array(cname + "FlatCode", data)
+    out += "#define VMBUILTINS %d\n\n" % len(names)
+    out += "#ifdef BENCHMARK\n" + flat + "#endif\n\n"
+    out += "const VmProgram vmPrograms[] PROGMEM = {\n"
+    for name in names:
+        out += "  {vm%s%sCode, sizeof(vm%s%sCode)},\n" % (name[0].upper(), name[1:], name[0].upper(), name[1:])
+    out += "#ifdef BENCHMARK\n"
+    for name in names:
+        out += "  {vm%s%sFlatCode, sizeof(vm%s%sFlatCode)},\n" % (name[0].upper(), name[1:], name[0].upper(), name[1:])
+    out += "#endif\n};\n"
+    return out
+
+
+def upload(port_name, slot, data):
+    import serial
+    port = serial.Serial(port_name, 115200, timeout=0.5)
+    time.sleep(2)  # the Pro Mini resets when the port opens
+    # show() blocks interrupts on the shades; the first bytes wake them up, and
+    # after those they stop showing for long enough to take the rest
+    port.write(b"\n")
+    time.sleep(0.01)
+    port.reset_input_buffer()
+    port.write(line(slot, data).encode("ascii"))
+    time.sleep(0.5)  # up to 64 EEPROM writes
+    replies = [l for l in port.read(port.in_waiting).decode("ascii", "replace").splitlines() if l.startswith("U,")]
+    if not replies or replies[-1].split(",")[2] != str(len(data)):
+        sys.exit("the shades didn't take it: %s" % (replies[-1] if replies else "no reply"))
+    print("slot %d: %d bytes" % (slot, len(data)))
+
+
+def line(slot, data):
+    return "u%d,%s\n" % (slot, "".join("%02x" % b for b in data))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("program", nargs="?")
+    parser.add_argument("--builtins", action="store_true", help="write vmdata.h from tools/vm/*.vm")
+    parser.add_argument("--no-hoist", action="store_true", help="leave the frame code empty")
+    parser.add_argument("--line", type=int, metavar="SLOT", help="print the Serial line that uploads to SLOT")
+    parser.add_argument("--port", help="serial port to upload to")
+    parser.add_argument("--slot", type=int, default=0, help="EEPROM slot to upload to (default 0)")
+    parser.add_argument("-o", "--output", help="file to write (default: stdout)")
+    args = parser.parse_args()
+    vm = Vm()
+
+    if args.builtins:
+        text = builtins(vm)
+    elif args.program:
+        data, frame, pixel = assemble(args.program, vm, not args.no_hoist)
+        if args.port:
+            upload(args.port, args.slot, data)
+            return
+        if args.line is not None:
+            text = line(args.line, data)
+        else:
+            text = "%s: %d bytes, %d ops a pixel, %d once a frame\n%s\n  hex: %s\n" % (
+                args.program, len(data), len(pixel), len(frame), listing(frame, pixel),
+                "".join("%02x" % b for b in data))
+    else:
+        parser.error("a program or --builtins")
+    if args.output:
+        open(args.output, "w").write(text)
+    else:
+        sys.stdout.write(text)
+
+
+if __name__ == "__main__":
+    main()
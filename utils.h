@@ -19,6 +19,79 @@ uint8_t fadeActive = 0;
 
 CRGBPalette16 currentPalette(RainbowColors_p); // global palette storage
 
+// Palette cache: currentPalette blended out to 32 or 64 colours once, when it
+// changes, so lookups are a table read instead of blending two entries and
+// scaling. The index is rounded to the nearest cached colour, 8 (or 4) steps
+// apart. Call cachePalette() after setting currentPalette; the select
+// functions below do.
+#if PALETTECACHE >= 192
+#define PALETTESHIFT 2
+#elif PALETTECACHE >= 96
+#define PALETTESHIFT 3
+#endif
+
+#ifdef PALETTESHIFT
+
+CRGB paletteCache[256 >> PALETTESHIFT];
+#define RAM_PALETTECACHE sizeof(paletteCache)
+
+void cachePalette() {
+  for (byte i = 0; i < (256 >> PALETTESHIFT); i++) {
+    paletteCache[i] = ColorFromPalette(currentPalette, i << PALETTESHIFT);
+  }
+}
+
+// the palette wraps around, so the top indexes round to the first colour
+inline CRGB paletteColor(byte index) {
+  return paletteCache[(byte)(index + (1 << (PALETTESHIFT - 1))) >> PALETTESHIFT];
+}
+
+#else
+
+#define RAM_PALETTECACHE 0
+
+void cachePalette() {
+}
+
+inline CRGB paletteColor(byte index) {
+  return ColorFromPalette(currentPalette, index);
+}
+
+#endif
+
+// Scale a looked up colour like ColorFromPalette() does, so a colour can be
+// looked up once and used at several brightnesses
+inline CRGB paletteScale(CRGB color, byte brightness) {
+  if (brightness != 255) color.nscale8(brightness ? brightness + 1 : 0);
+  return color;
+}
+
+inline CRGB paletteColor(byte index, byte brightness) {
+  return paletteScale(paletteColor(index), brightness);
+}
+
+#ifdef BENCHMARK
+// Time a palette lookup for every LED as BENCH_PALETTE + 0 (ColorFromPalette),
+// 1 (paletteColor), 2 (paletteColor with a brightness) and 3 (cachePalette)
+void paletteBench() {
+  currentPalette = PartyColors_p;
+  cachePalette(); // or steps 1 and 2 read the last effect's palette
+  for (byte step = 0; step < 4; step++) {
+    GPIOR1 = BENCH_PALETTE | step;
+    for (uint16_t i = 0; i < BENCH_FRAMES; i++) {
+      STAGE_BEGIN(STAGE_EFFECT);
+      for (byte j = 0; j <= LAST_VISIBLE_LED; j++) {
+        if (step == 0) leds[j] = ColorFromPalette(currentPalette, j * 3 + i, j * 2);
+        else if (step == 1) leds[j] = paletteColor(j * 3 + i);
+        else if (step == 2) leds[j] = paletteColor(j * 3 + i, j * 2);
+        else if (j == 0) cachePalette();
+      }
+      STAGE_END(STAGE_EFFECT);
+    }
+  }
+}
+#endif
+
 typedef void (*functionList)(); // definition for list of effect function pointers
 extern byte numEffects;
 
@@ -64,10 +137,26 @@ void scrollArray(byte scrollDir) {
 }
 
 
-// Pick a random palette from a list
-void selectRandomPalette() {
+// 32-bit FNV-1a hash of the visible LEDs, for checking that builds render identically
+uint32_t frameHash() {
+  uint32_t hash = 2166136261UL;
+  const byte *data = (const byte *)leds;
+  for (byte i = 0; i < (LAST_VISIBLE_LED + 1) * 3; i++) {
+    hash ^= data[i];
+    hash *= 16777619UL;
+  }
+  return hash;
+}
 
-  switch(random8(8)) {
+#ifdef SHOW
+#define SHOWNOPALETTE 255
+byte showPalette = SHOWNOPALETTE; // picked by a playing show (show.h)
+#endif
+
+// Set one of the palettes below, 3 leaves the palette as it is
+void selectPalette(byte which) {
+
+  switch(which) {
     case 0:
     currentPalette = CloudColors_p;
     break;
@@ -96,9 +185,19 @@ void selectRandomPalette() {
     currentPalette = HeatColors_p;
     break;
   }
+  cachePalette();
 
 }
 
+// Pick a random palette from a list
+void selectRandomPalette() {
+  byte which = random8(8);
+#ifdef SHOW
+  if (showPalette != SHOWNOPALETTE) which = showPalette;
+#endif
+  selectPalette(which);
+}
+
 // Pick a random palette from a list
 void selectRandomAudioPalette() {
 
@@ -131,6 +230,7 @@ void selectRandomAudioPalette() {
     currentPalette = HeatColors_p;
     break;
   }
+  cachePalette();
 
 }
 
@@ -165,20 +265,7 @@ void selectRandomNoisePalette() {
     currentPalette = HeatColors_p;
     break;
   }
-
-}
-
-// Interrupt normal operation to indicate that auto cycle mode has changed
-void confirmBlink(CRGB blinkColor, byte count) {
-
-  for (byte i = 0; i < count; i++) {
-    fillAll(blinkColor);
-    FastLED.show();
-    delay(200);
-    fillAll(CRGB::Black);
-    FastLED.show();
-    delay(200);
-  }
+  cachePalette();
 
 }
 
@@ -212,27 +299,12 @@ char loadStringChar(byte string, byte character) {
 }
 
 // write EEPROM value if it's different from stored value
-void updateEEPROM(byte location, byte value) {
+void updateEEPROM(uint16_t location, byte value) {
   if (EEPROM.read(location) != value) EEPROM.write(location, value);
 }
 
-// Write settings to EEPROM if necessary
-void checkEEPROM() {
-  if (eepromOutdated) {
-    if (currentMillis - eepromMillis > EEPROMDELAY) {
-      updateEEPROM(0, 99);
-      updateEEPROM(1, currentEffect);
-      updateEEPROM(2, autoCycle);
-      updateEEPROM(3, currentBrightness);
-      updateEEPROM(4, audioEnabled);
-      eepromOutdated = false;
-    }
-  }
-}
-
 
-#define MAX_DIMENSION ((kMatrixWidth>kMatrixHeight) ? kMatrixWidth : kMatrixHeight)
-uint8_t noise[MAX_DIMENSION][MAX_DIMENSION];
+uint8_t noise[kMatrixWidth][kMatrixHeight];
 uint16_t scale = 72;
 static uint16_t nx;
 static uint16_t ny;
@@ -241,9 +313,9 @@ uint16_t nspeed = 0;
 
 // Fill the x/y array of 8-bit noise values using the inoise8 function.
 void fillnoise8() {
-  for(int i = 0; i < MAX_DIMENSION; i++) {
+  for(int i = 0; i < kMatrixWidth; i++) {
     int ioffset = scale * i;
-    for(int j = 0; j < MAX_DIMENSION; j++) {
+    for(int j = 0; j < kMatrixHeight; j++) {
       int joffset = scale * j;
       noise[i][j] = inoise8(nx + ioffset,ny + joffset,nz);
     }
@@ -0,0 +1,356 @@
+// Bytecode effects
+//
+// A small stack machine runs a program once for every pixel of the 16x5
+// grid, so a new effect can be sent over Serial and kept in EEPROM instead
+// of reflashing. vmEffect0() to vmEffect2() play the programs in the
+// VMSLOTS EEPROM slots; put them in an effect list like any other effect.
+// An empty slot shows black. vmThreeSine() and vmSlantBars() play the
+// built-in programs in vmdata.h, which draw what threeSine() and
+// slantBars() do, for comparing with them.
+//
+// tools/vmasm.py assembles and uploads programs. A program is
+//   effectDelay, frame code, VMEND, pixel code ending in VMPAL, VMHSV or VMRGB
+// The frame code runs once a frame and leaves its values in VMREGS
+// registers for the pixel code (the assembler moves everything that doesn't
+// depend on x and y there). Values are bytes and arithmetic wraps, except
+// the q ops, which saturate like FastLED's. Operands are pushed in order, so
+// "a b VMSUB" is a - b. Programs are checked when they are loaded, so the
+// interpreter doesn't check anything: each op jumps straight to the next
+// one through a table of label addresses in flash.
+//
+// EEPROM slot: length, the program, CRC-8 of both (see settings.h).
+// Serial (see serial.h): u<slot>,<program in hex> writes a slot, and
+// replies U,<slot>,<length>, or U,<slot>,0 if the program was rejected or
+// the slot erased. The upload is read into vmCode, so a running program
+// holds its last frame until the upload ends, then loads again.
+
+#define VMPUSH 0   // n: push n
+#define VMLOAD 1   // r: push register r
+#define VMSTORE 2  // r: pop into register r, frame code only
+#define VMBAND 3   // n: push band n of spectrumDecay[], 0 to 255
+#define VMX 4      // pixel code only
+#define VMY 5      // pixel code only
+#define VMT 6      // frames since the effect started
+#define VMHUE 7    // cycleHue
+#define VMDUP 8
+#define VMSWAP 9
+#define VMADD 10
+#define VMSUB 11
+#define VMMUL 12   // low byte of a * b
+#define VMSCALE 13 // scale8(a, b)
+#define VMQADD 14
+#define VMQSUB 15
+#define VMQMUL 16
+#define VMDIFF 17  // |a - b|
+#define VMINV 18   // 255 - a
+#define VMSIN 19   // sin8(a)
+#define VMCOS 20   // cos8(a)
+#define VMTRI 21   // triwave8(a)
+#define VMNOISE 22 // inoise8(a * 8, b * 8, frames * 4)
+#define VMEND 23   // end of the frame code
+#define VMPAL 24   // index, brightness: paletteColor()
+#define VMHSV 25   // hue, saturation, value
+#define VMRGB 26   // red, green, blue
+#define VMOPS 27
+
+#define VMIMMEDIATE(op) ((op) <= VMBAND) // followed by a byte
+
+#define VMSTACK 8
+#define VMREGS 4
+#define VMSLOTS 3
+#define VMSLOTSIZE 85 // the 256 bytes after the settings ring
+#define VMCODESIZE (VMSLOTSIZE - 2)
+#define VMEEPROM SETTINGSEND // the slots are after the settings ring
+#define VMFPS 50             // bench/compare.py flags VM rows slower than this
+#define VMBUILTIN 0x80       // vmLoaded for the programs in vmdata.h
+#define VMNONE 0xFF
+
+#ifdef VM
+
+#include "vmdata.h"
+
+byte vmCode[VMCODESIZE];    // the program being run
+byte vmLoaded = VMNONE;     // which one: a slot, VMBUILTIN + n, or VMNONE
+byte vmPixelStart;          // where its pixel code starts, 0 if it can't be run
+byte vmRegs[VMREGS];
+uint16_t vmFrames;
+boolean vmUploading = false; // vmCode holds a Serial upload, not a program to run
+
+// Check a program before it is run: known ops, frame and pixel code in the
+// right places, the stack neither under- nor overflowing, and registers in
+// range. Its pixel code start, or 0 if it can't be run.
+byte vmCheck(const byte *code, byte length) {
+  // stack effect of each op: what it takes, what it leaves
+  static const byte takes[VMOPS] PROGMEM = {0, 0, 1, 0, 0, 0, 0, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1, 1, 2, 0, 2, 3, 3};
+  static const byte gives[VMOPS] PROGMEM = {1, 1, 0, 1, 1, 1, 1, 1, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0};
+  byte depth = 0;
+  byte pixelStart = 0;
+  for (byte pc = 1; pc < length; pc++) {
+    byte op = code[pc];
+    if (op >= VMOPS) return 0;
+    if (VMIMMEDIATE(op)) {
+      if (++pc >= length) return 0;
+      if ((op == VMLOAD || op == VMSTORE) && code[pc] >= VMREGS) return 0;
+      if (op == VMBAND && code[pc] >= 7) return 0;
+    }
+    boolean inFrame = pixelStart == 0;
+    if (inFrame && (op == VMX || op == VMY || op >= VMPAL)) return 0;
+    if (!inFrame && (op == VMSTORE || op == VMEND)) return 0;
+    if (depth < pgm_read_byte(&takes[op])) return 0;
+    depth += pgm_read_byte(&gives[op]) - pgm_read_byte(&takes[op]);
+    if (depth > VMSTACK) return 0;
+    if (op == VMEND) {
+      if (depth) return 0;
+      pixelStart = pc + 1;
+    } else if (op >= VMPAL) {
+      return depth == 0 && pc == length - 1 ? pixelStart : 0; // one output, at the end
+    }
+  }
+  return 0;
+}
+
+// Load a program into vmCode from a slot or from flash, true if it can be run.
+// A slot that is empty or corrupt stays loaded as such, so it is read once.
+boolean vmLoad(byte source) {
+  byte length;
+  if (source & VMBUILTIN) {
+    const VmProgram *program = &vmPrograms[source & ~VMBUILTIN];
+    length = pgm_read_byte(&program->length);
+    memcpy_P(vmCode, (const byte *)pgm_read_word(&program->code), length);
+  } else {
+    uint16_t address = VMEEPROM + source * VMSLOTSIZE;
+    settingsFlush(); // EEPROM.read() and the settings interrupt mustn't overlap either
+    length = EEPROM.read(address);
+    if (length > VMCODESIZE) length = 0;
+    for (byte i = 0; i < length; i++) vmCode[i] = EEPROM.read(address + 1 + i);
+    if (length && crc8(vmCode, length, crc8(&length, 1)) != EEPROM.read(address + 1 + length)) length = 0;
+  }
+  vmPixelStart = length ? vmCheck(vmCode, length) : 0;
+  vmLoaded = source;
+  return vmPixelStart != 0;
+}
+
+#define VMNEXT goto *(const void *)pgm_read_word(&vmLabels[*pc++])
+
+// Run the frame code, then the pixel code for every pixel
+void vmRender() {
+  static const void *const vmLabels[VMOPS] PROGMEM = {
+    &&opPush, &&opLoad, &&opStore, &&opBand, &&opX, &&opY, &&opT, &&opHue, &&opDup, &&opSwap,
+    &&opAdd, &&opSub, &&opMul, &&opScale, &&opQadd, &&opQsub, &&opQmul, &&opDiff, &&opInv, &&opSin,
+    &&opCos, &&opTri, &&opNoise, &&opEnd, &&opPal, &&opHsv, &&opRgb};
+  byte stack[VMSTACK];
+  byte *sp = stack; // next free
+  const byte *pc = vmCode + 1;
+  byte x = 0, y = 0;
+  VMNEXT;
+
+opPush:
+  *sp++ = *pc++;
+  VMNEXT;
+opLoad:
+  *sp++ = vmRegs[*pc++];
+  VMNEXT;
+opStore:
+  vmRegs[*pc++] = *--sp;
+  VMNEXT;
+opBand:
+  *sp++ = spectrumDecay[*pc] > 1023 ? 255 : spectrumDecay[*pc] >> 2;
+  pc++;
+  VMNEXT;
+opX:
+  *sp++ = x;
+  VMNEXT;
+opY:
+  *sp++ = y;
+  VMNEXT;
+opT:
+  *sp++ = vmFrames;
+  VMNEXT;
+opHue:
+  *sp++ = cycleHue;
+  VMNEXT;
+opDup:
+  sp[0] = sp[-1];
+  sp++;
+  VMNEXT;
+opSwap: {
+    byte a = sp[-2];
+    sp[-2] = sp[-1];
+    sp[-1] = a;
+  }
+  VMNEXT;
+opAdd:
+  sp--;
+  sp[-1] += sp[0];
+  VMNEXT;
+opSub:
+  sp--;
+  sp[-1] -= sp[0];
+  VMNEXT;
+opMul:
+  sp--;
+  sp[-1] *= sp[0];
+  VMNEXT;
+opScale:
+  sp--;
+  sp[-1] = scale8(sp[-1], sp[0]);
+  VMNEXT;
+opQadd:
+  sp--;
+  sp[-1] = qadd8(sp[-1], sp[0]);
+  VMNEXT;
+opQsub:
+  sp--;
+  sp[-1] = qsub8(sp[-1], sp[0]);
+  VMNEXT;
+opQmul:
+  sp--;
+  sp[-1] = qmul8(sp[-1], sp[0]);
+  VMNEXT;
+opDiff:
+  sp--;
+  sp[-1] = sp[-1] > sp[0] ? sp[-1] - sp[0] : sp[0] - sp[-1];
+  VMNEXT;
+opInv:
+  sp[-1] = 255 - sp[-1];
+  VMNEXT;
+opSin:
+  sp[-1] = sin8(sp[-1]);
+  VMNEXT;
+opCos:
+  sp[-1] = cos8(sp[-1]);
+  VMNEXT;
+opTri:
+  sp[-1] = triwave8(sp[-1]);
+  VMNEXT;
+opNoise:
+  sp--;
+  sp[-1] = inoise8(sp[-1] << 3, sp[0] << 3, vmFrames << 2);
+  VMNEXT;
+opEnd:
+  pc = vmCode + vmPixelStart;
+  VMNEXT;
+opPal:
+  sp -= 2;
+  leds[XY(x, y)] = paletteColor(sp[0], sp[1]);
+  goto pixel;
+opHsv:
+  sp -= 3;
+  leds[XY(x, y)] = CHSV(sp[0], sp[1], sp[2]);
+  goto pixel;
+opRgb:
+  sp -= 3;
+  leds[XY(x, y)] = CRGB(sp[0], sp[1], sp[2]);
+
+pixel:
+  pc = vmCode + vmPixelStart;
+  if (++y < kMatrixHeight) VMNEXT;
+  y = 0;
+  if (++x < kMatrixWidth) VMNEXT;
+}
+
+// Play a program: a slot, or VMBUILTIN + n
+void vmEffect(byte source) {
+  if (vmUploading) return; // vmCode is being filled, keep the last frame
+
+  if (effectInit == false || vmLoaded != source) {
+    effectInit = true;
+    fadeActive = 0;
+    effectDelay = vmLoad(source) ? vmCode[0] : 100;
+    vmFrames = 0;
+    memset(vmRegs, 0, sizeof(vmRegs));
+  }
+
+  if (!vmPixelStart) {
+    fillAll(CRGB::Black);
+    return;
+  }
+  vmRender();
+  vmFrames++;
+}
+
+void vmEffect0() { vmEffect(0); }
+void vmEffect1() { vmEffect(1); }
+void vmEffect2() { vmEffect(2); }
+void vmThreeSine() { vmEffect(VMBUILTIN + VMTHREESINE); }
+void vmSlantBars() { vmEffect(VMBUILTIN + VMSLANTBARS); }
+
+#ifdef BENCHMARK
+// Time each program in vmdata.h as BENCH_VM + 2 n, and as written, without the
+// frame code the assembler pulled out of the pixel loop, as BENCH_VM + 2 n + 1
+void vmBench() {
+  for (byte step = 0; step < VMBUILTINS * 2; step++) {
+    GPIOR1 = BENCH_VM | step;
+    effectInit = false;
+    for (uint16_t i = 0; i < BENCH_FRAMES; i++) {
+      STAGE_BEGIN(STAGE_EFFECT);
+      vmEffect(VMBUILTIN + (step & 1) * VMBUILTINS + step / 2);
+      STAGE_END(STAGE_EFFECT);
+    }
+  }
+}
+#endif
+
+// Serial upload: the slot, a comma, then the program in hex up to the newline
+byte vmUploadSlot;
+byte vmUploadLength;
+byte vmUploadNibble; // the high nibble waiting for its low one, or 0xFF
+boolean vmUploadData;
+
+void vmUploadBegin() {
+  vmUploading = true;
+  vmLoaded = VMNONE; // the program is read into vmCode, a running one reloads after
+  vmUploadSlot = 0;
+  vmUploadLength = 0;
+  vmUploadNibble = 0xFF;
+  vmUploadData = false;
+}
+
+// Take the next byte of an upload, true at the end of it
+boolean vmUploadByte(byte data) {
+  byte value = data >= '0' && data <= '9' ? data - '0' : data >= 'a' && data <= 'f' ? data - 'a' + 10 :
+               data >= 'A' && data <= 'F' ? data - 'A' + 10 : 0xFF;
+  if (!vmUploadData) {
+    if (value < 10) {
+      vmUploadSlot = vmUploadSlot * 10 + value;
+      return false;
+    }
+    if (data == ',') {
+      vmUploadData = true;
+      return false;
+    }
+  } else if (value != 0xFF) {
+    if (vmUploadNibble == 0xFF) {
+      vmUploadNibble = value;
+    } else if (vmUploadLength < VMCODESIZE) {
+      vmCode[vmUploadLength++] = vmUploadNibble << 4 | value;
+      vmUploadNibble = 0xFF;
+    } else {
+      vmUploadLength = VMCODESIZE + 1; // too long
+    }
+    return false;
+  }
+
+  // the end: an empty program erases the slot
+  vmUploading = false;
+  Serial.print('U');
+  Serial.print(',');
+  Serial.print(vmUploadSlot);
+  Serial.print(',');
+  if (vmUploadSlot >= VMSLOTS) {
+    Serial.println(0);
+    return true;
+  }
+  if (vmUploadLength > VMCODESIZE || vmUploadNibble != 0xFF || (vmUploadLength && !vmCheck(vmCode, vmUploadLength))) {
+    vmUploadLength = 0;
+  }
+  settingsFlush(); // EEPROM.write() and the settings interrupt mustn't overlap
+  uint16_t address = VMEEPROM + vmUploadSlot * VMSLOTSIZE;
+  updateEEPROM(address, vmUploadLength);
+  for (byte i = 0; i < vmUploadLength; i++) updateEEPROM(address + 1 + i, vmCode[i]);
+  updateEEPROM(address + 1 + vmUploadLength, crc8(vmCode, vmUploadLength, crc8(&vmUploadLength, 1)));
+  Serial.println(vmUploadLength);
+  return true;
+}
+
+#endif
@@ -0,0 +1,53 @@
+// Built-in programs for vm.h
+//
+// Written by tools/vmasm.py --builtins -o vmdata.h from tools/vm/*.vm
+// Reassemble rather than edit. The BENCHMARK build also has each one as
+// written, without moving anything to the frame code, at VMBUILTINS + n.
+
+struct VmProgram {
+  const byte *code;
+  byte length;
+};
+
+// slantBars.vm: 25 bytes, 13 ops a pixel
+const byte vmSlantBarsCode[] PROGMEM = {
+  5, 6, 0, 252, 12, 2, 0, 23, 7, 0, 255, 4, 0, 32, 12, 5,
+  0, 32, 12, 10, 1, 0, 10, 19, 25,
+};
+#define VMSLANTBARS 0
+
+// threeSine.vm: 72 bytes, 40 ops a pixel
+const byte vmThreeSineCode[] PROGMEM = {
+  20, 6, 0, 9, 12, 2, 0, 6, 0, 10, 12, 2, 1, 6, 0, 11,
+  12, 2, 2, 23, 1, 0, 4, 0, 16, 12, 10, 19, 5, 0, 51, 12,
+  17, 0, 2, 16, 18, 1, 1, 4, 0, 16, 12, 10, 19, 5, 0, 51,
+  12, 17, 0, 2, 16, 18, 1, 2, 4, 0, 16, 12, 10, 19, 5, 0,
+  51, 12, 17, 0, 2, 16, 18, 26,
+};
+#define VMTHREESINE 1
+
+#define VMBUILTINS 2
+
+#ifdef BENCHMARK
+// slantBars.vm as written: 21 bytes, 15 ops a pixel
+const byte vmSlantBarsFlatCode[] PROGMEM = {
+  5, 23, 7, 0, 255, 4, 0, 32, 12, 5, 0, 32, 12, 10, 6, 0,
+  252, 12, 10, 19, 25,
+};
+// threeSine.vm as written: 60 bytes, 46 ops a pixel
+const byte vmThreeSineFlatCode[] PROGMEM = {
+  20, 23, 6, 0, 9, 12, 4, 0, 16, 12, 10, 19, 5, 0, 51, 12,
+  17, 0, 2, 16, 18, 6, 0, 10, 12, 4, 0, 16, 12, 10, 19, 5,
+  0, 51, 12, 17, 0, 2, 16, 18, 6, 0, 11, 12, 4, 0, 16, 12,
+  10, 19, 5, 0, 51, 12, 17, 0, 2, 16, 18, 26,
+};
+#endif
+
+const VmProgram vmPrograms[] PROGMEM = {
+  {vmSlantBarsCode, sizeof(vmSlantBarsCode)},
+  {vmThreeSineCode, sizeof(vmThreeSineCode)},
+#ifdef BENCHMARK
+  {vmSlantBarsFlatCode, sizeof(vmSlantBarsFlatCode)},
+  {vmThreeSineFlatCode, sizeof(vmThreeSineFlatCode)},
+#endif
+};